@@ -0,0 +1,174 @@
+// bench_book_formats.c
+//
+// Microbenchmark dei formati dei libri: per ognuno dei quattro endpoint CRUD
+// confronta JSON e MessagePack in byte trasmessi (richiesta e risposta
+// complete di header) e tempo di CPU per richiesta. Ogni giro fa il lavoro
+// del server che dipende dal formato: parsing HTTP, lettura del body,
+// serializzazione del libro e costruzione della risposta. Redis e la rete
+// sono esclusi, costano uguale con entrambi i formati.
+//
+// Uso: make bench && ./bin/bench_book_formats [iterazioni]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "http_utils.h"
+#include "book.h"
+
+#define DEFAULT_ITERATIONS 500000
+#define REQUEST_BUFFER_SIZE 1024
+
+typedef struct {
+    const char *name;
+    http_method_t method;
+    const char *method_str;
+    const char *path;
+    bool has_body;              // POST e PUT mandano il libro
+    http_status_t status;
+} endpoint_t;
+
+static const endpoint_t endpoints[] = {
+    { "POST /books",        HTTP_POST,   "POST",   "/books",     true,  HTTP_CREATED },
+    { "GET /books/{id}",    HTTP_GET,    "GET",    "/books/42",  false, HTTP_OK },
+    { "PUT /books/{id}",    HTTP_PUT,    "PUT",    "/books/42",  true,  HTTP_OK },
+    { "DELETE /books/{id}", HTTP_DELETE, "DELETE", "/books/42",  false, HTTP_NO_CONTENT },
+};
+
+static const Book sample_book = {
+    .id = 42,
+    .title = "Il nome della rosa",
+    .author = "Umberto Eco",
+    .price = 19.9,
+};
+
+static const char *format_name(book_format_t format) {
+    return format == BOOK_FORMAT_MSGPACK ? "MessagePack" : "JSON";
+}
+
+static const char *format_media_type(book_format_t format) {
+    return format == BOOK_FORMAT_MSGPACK ? MSGPACK_CONTENT_TYPE : "application/json";
+}
+
+// Serializza il libro nel formato scelto nel body di response
+static int write_book(http_response_t *response, book_format_t format, const Book *book) {
+    if (format == BOOK_FORMAT_MSGPACK) {
+        msgpack_writer_t writer;
+        msgpack_writer_init(&writer, response);
+        write_book_msgpack(&writer, book);
+        return msgpack_writer_finish(&writer);
+    }
+
+    json_writer_t writer;
+    json_writer_init(&writer, response);
+    write_book_json(&writer, book);
+    return json_writer_finish(&writer);
+}
+
+// Richiesta completa come la manderebbe un client; ritorna la lunghezza
+static size_t build_request(char *out, const endpoint_t *endpoint, book_format_t format) {
+    size_t length = snprintf(out, REQUEST_BUFFER_SIZE,
+                             "%s %s HTTP/1.1\r\nHost: localhost:8080\r\nAccept: %s\r\n",
+                             endpoint->method_str, endpoint->path, format_media_type(format));
+    if (!endpoint->has_body) {
+        return length + snprintf(out + length, REQUEST_BUFFER_SIZE - length, "\r\n");
+    }
+
+    http_response_t *body = create_http_response();
+    if (!body || write_book(body, format, &sample_book) != 0) {
+        printf("Errore nella serializzazione del body\n");
+        exit(EXIT_FAILURE);
+    }
+
+    length += snprintf(out + length, REQUEST_BUFFER_SIZE - length,
+                       "Content-Type: %s\r\nContent-Length: %zu\r\n\r\n",
+                       format_media_type(format), body->body_length);
+    memcpy(out + length, http_response_body(body), body->body_length);
+    length += body->body_length;
+
+    free_http_response(body);
+    return length;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Il parser modifica il buffer in place: ogni giro parte da una copia fresca
+static void bench_endpoint(const endpoint_t *endpoint, book_format_t format, long iterations) {
+    char request_text[REQUEST_BUFFER_SIZE];
+    char buffer[REQUEST_BUFFER_SIZE];
+    size_t request_length = build_request(request_text, endpoint, format);
+    size_t response_length = 0;
+
+    double start = now_seconds();
+
+    for (long i = 0; i < iterations; i++) {
+        http_request_t request;
+        http_parser_t parser;
+        Book book;
+
+        memcpy(buffer, request_text, request_length);
+        http_request_init(&request);
+        http_parser_init(&parser);
+
+        if (http_parser_execute(&parser, &request, buffer, request_length) != HTTP_PARSE_COMPLETE) {
+            printf("Errore nel parsing della richiesta (%s)\n", endpoint->name);
+            exit(EXIT_FAILURE);
+        }
+        // Il buffer resta di questa funzione: la richiesta non va liberata
+        http_request_set_buffer(&request, buffer, parser.body_start);
+
+        book = sample_book;
+        if (endpoint->has_body) {
+            int parsed = format == BOOK_FORMAT_MSGPACK
+                ? parse_book_msgpack(request.body, request.body_length, &book, NULL)
+                : parse_book_json(request.body, request.body_length, &book, NULL);
+            if (!parsed) {
+                printf("Errore nella lettura del body (%s)\n", endpoint->name);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        // DELETE risponde 204, senza body
+        http_response_t *response = create_http_response();
+        if (!response || (endpoint->status != HTTP_NO_CONTENT && write_book(response, format, &book) != 0)) {
+            printf("Errore nella risposta (%s)\n", endpoint->name);
+            exit(EXIT_FAILURE);
+        }
+        set_response_status(response, endpoint->status);
+        add_response_vary(response, "Accept");
+        set_response_keep_alive(response, 1);
+
+        if (build_response(response) != 0) {
+            printf("Errore nella costruzione della risposta (%s)\n", endpoint->name);
+            exit(EXIT_FAILURE);
+        }
+        response_length = response->response_size;
+        free_http_response(response);
+    }
+
+    double elapsed = now_seconds() - start;
+    printf("%-20s %-12s %9zu %9zu %9zu %10.1f\n", endpoint->name, format_name(format),
+           request_length, response_length, request_length + response_length,
+           elapsed * 1e9 / iterations);
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) {
+        iterations = DEFAULT_ITERATIONS;
+    }
+
+    printf("%ld iterazioni per endpoint e formato\n\n", iterations);
+    printf("%-20s %-12s %9s %9s %9s %10s\n", "endpoint", "formato", "richiesta", "risposta", "totale", "ns/rich.");
+
+    for (size_t i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); i++) {
+        bench_endpoint(&endpoints[i], BOOK_FORMAT_JSON, iterations);
+        bench_endpoint(&endpoints[i], BOOK_FORMAT_MSGPACK, iterations);
+    }
+
+    return EXIT_SUCCESS;
+}
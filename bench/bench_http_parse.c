@@ -0,0 +1,276 @@
+// bench_http_parse.c
+//
+// Microbenchmark del parser HTTP: confronta il parser della versione
+// originale (strstr + strtok su una copia, sscanf, strncpy in array fissi)
+// con quello attuale, forzando a turno ogni implementazione di http_scan.
+//
+// Uso: make bench && ./bin/bench_http_parse [iterazioni]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "http_utils.h"
+#include "http_scan.h"
+
+#define DEFAULT_ITERATIONS 500000
+
+static const char sample_request[] =
+    "POST /add/book?source=bench&lang=it HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: it-IT,it;q=0.8,en-US;q=0.5,en;q=0.3\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Referer: http://localhost:8080/books/index.html\r\n"
+    "Cookie: session=4f1c2a9be0d8437fa1c6e5b2d9f08a73; theme=dark; lang=it\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 72\r\n"
+    "\r\n"
+    "{\"id_book\": 42, \"title\": \"Il nome della rosa\", \"author\": \"Eco\", \"price\": 1}";
+
+// --- Parser originale, riportato qui solo come termine di paragone ---
+
+#define LEGACY_HEADER_VALUE_LEN 1024
+
+typedef struct {
+    char name[MAX_HEADER_NAME_LEN];
+    char value[LEGACY_HEADER_VALUE_LEN];
+} legacy_header_t;
+
+typedef struct {
+    char name[MAX_PARAM_NAME_LEN];
+    char value[MAX_PARAM_VALUE_LEN];
+} legacy_param_t;
+
+typedef struct {
+    http_method_t method;
+    char method_str[MAX_METHOD_LEN];
+    char uri[MAX_URI_LEN];
+    char path[MAX_URI_LEN];
+    char query_string[MAX_URI_LEN];
+    char version[MAX_VERSION_LEN];
+    legacy_header_t headers[MAX_HEADERS];
+    int header_count;
+    legacy_param_t query_params[MAX_QUERY_PARAMS];
+    int query_param_count;
+    char *body;
+    size_t body_length;
+    size_t content_length;
+} legacy_request_t;
+
+// L'originale usava strtok anche qui, azzerando lo stato dello strtok sugli
+// header: con una query string gli header andavano persi. strtok_r permette
+// di confrontare lo stesso lavoro
+static void legacy_parse_query_string(const char *query_string, legacy_request_t *request) {
+    char *query_copy = strdup(query_string);
+    if (!query_copy) return;
+
+    char *saveptr;
+    char *param = strtok_r(query_copy, "&", &saveptr);
+    while (param && request->query_param_count < MAX_QUERY_PARAMS) {
+        char *equals = strchr(param, '=');
+        if (equals) {
+            *equals = '\0';
+            url_decode(request->query_params[request->query_param_count].name, param);
+            url_decode(request->query_params[request->query_param_count].value, equals + 1);
+        } else {
+            url_decode(request->query_params[request->query_param_count].name, param);
+            request->query_params[request->query_param_count].value[0] = '\0';
+        }
+        request->query_param_count++;
+        param = strtok_r(NULL, "&", &saveptr);
+    }
+
+    free(query_copy);
+}
+
+static int legacy_parse_request_line(const char *line, legacy_request_t *request) {
+    char method[MAX_METHOD_LEN];
+    char uri[MAX_URI_LEN];
+    char version[MAX_VERSION_LEN];
+
+    if (sscanf(line, "%15s %2047s %15s", method, uri, version) != 3) {
+        return -1;
+    }
+
+    strncpy(request->method_str, method, MAX_METHOD_LEN - 1);
+    request->method_str[MAX_METHOD_LEN - 1] = '\0';
+    request->method = string_to_method(method);
+    strncpy(request->uri, uri, MAX_URI_LEN - 1);
+    request->uri[MAX_URI_LEN - 1] = '\0';
+
+    char *query_start = strchr(uri, '?');
+    if (query_start) {
+        *query_start = '\0';
+        strncpy(request->path, uri, MAX_URI_LEN - 1);
+        request->path[MAX_URI_LEN - 1] = '\0';
+        strncpy(request->query_string, query_start + 1, MAX_URI_LEN - 1);
+        request->query_string[MAX_URI_LEN - 1] = '\0';
+        legacy_parse_query_string(request->query_string, request);
+    } else {
+        strncpy(request->path, uri, MAX_URI_LEN - 1);
+        request->path[MAX_URI_LEN - 1] = '\0';
+    }
+
+    strncpy(request->version, version, MAX_VERSION_LEN - 1);
+    request->version[MAX_VERSION_LEN - 1] = '\0';
+    return 0;
+}
+
+static int legacy_parse_header_line(const char *line, legacy_request_t *request) {
+    if (request->header_count >= MAX_HEADERS) return -1;
+
+    char *colon = strchr(line, ':');
+    if (!colon) return -1;
+
+    size_t name_len = colon - line;
+    if (name_len >= MAX_HEADER_NAME_LEN) return -1;
+
+    legacy_header_t *header = &request->headers[request->header_count];
+    strncpy(header->name, line, name_len);
+    header->name[name_len] = '\0';
+    trim_whitespace(header->name);
+    strncpy(header->value, colon + 1, LEGACY_HEADER_VALUE_LEN - 1);
+    header->value[LEGACY_HEADER_VALUE_LEN - 1] = '\0';
+    trim_whitespace(header->value);
+
+    if (strcasecmp(header->name, "Content-Length") == 0) {
+        request->content_length = strtoul(header->value, NULL, 10);
+    }
+
+    request->header_count++;
+    return 0;
+}
+
+static int legacy_parse_http_request(const char *raw_request, legacy_request_t *request) {
+    const char *header_end = strstr(raw_request, "\r\n\r\n");
+    if (!header_end) return -1;
+
+    size_t header_length = header_end - raw_request;
+    char *headers_copy = malloc(header_length + 1);
+    if (!headers_copy) return -1;
+    memcpy(headers_copy, raw_request, header_length);
+    headers_copy[header_length] = '\0';
+
+    char *line = strtok(headers_copy, "\r\n");
+    if (!line || legacy_parse_request_line(line, request) != 0) {
+        free(headers_copy);
+        return -1;
+    }
+
+    while ((line = strtok(NULL, "\r\n")) != NULL) {
+        legacy_parse_header_line(line, request);
+    }
+    free(headers_copy);
+
+    const char *body_start = strstr(raw_request, "\r\n\r\n") + 4;
+    size_t remaining = strlen(raw_request) - (body_start - raw_request);
+    size_t body_size = remaining < request->content_length ? remaining : request->content_length;
+    request->body = malloc(body_size + 1);
+    if (request->body) {
+        memcpy(request->body, body_start, body_size);
+        request->body[body_size] = '\0';
+        request->body_length = body_size;
+    }
+
+    return 0;
+}
+
+// --- Misure ---
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, long iterations, int headers, double elapsed) {
+    printf("%-18s %10.0f richieste/s %12.0f header/s %8.1f ns/richiesta\n",
+           name, iterations / elapsed, (double)iterations * headers / elapsed,
+           elapsed * 1e9 / iterations);
+}
+
+// Come nel server originale: calloc della richiesta, parsing, free
+static int bench_legacy(long iterations) {
+    int headers = 0;
+    double start = now_seconds();
+
+    for (long i = 0; i < iterations; i++) {
+        legacy_request_t *request = calloc(1, sizeof(legacy_request_t));
+        if (!request || legacy_parse_http_request(sample_request, request) != 0) {
+            printf("Errore nel parsing (originale)\n");
+            exit(EXIT_FAILURE);
+        }
+        headers = request->header_count;
+        free(request->body);
+        free(request);
+    }
+
+    report("originale", iterations, headers, now_seconds() - start);
+    return headers;
+}
+
+// Il parser attuale modifica il buffer in place: ogni giro parte da una copia
+// fresca, come il buffer di ricezione di una connessione
+static int bench_current(long iterations, http_scan_level_t level) {
+    if (http_scan_select(level) != 0) {
+        printf("%-18s non supportato dalla CPU\n", http_scan_level_name(level));
+        return -1;
+    }
+
+    size_t length = sizeof(sample_request) - 1;
+    char *buffer = malloc(length + 1);
+    if (!buffer) {
+        exit(EXIT_FAILURE);
+    }
+
+    int headers = 0;
+    double start = now_seconds();
+
+    for (long i = 0; i < iterations; i++) {
+        http_request_t request;
+        http_parser_t parser;
+
+        memcpy(buffer, sample_request, length);
+        http_request_init(&request);
+        http_parser_init(&parser);
+
+        if (http_parser_execute(&parser, &request, buffer, length) != HTTP_PARSE_COMPLETE) {
+            printf("Errore nel parsing (%s)\n", http_scan_level_name(level));
+            exit(EXIT_FAILURE);
+        }
+        headers = request.header_count;
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "attuale/%s", http_scan_level_name(level));
+    report(name, iterations, headers, now_seconds() - start);
+
+    free(buffer);
+    return headers;
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) {
+        iterations = DEFAULT_ITERATIONS;
+    }
+
+    printf("Richiesta di %zu byte, %ld iterazioni\n\n", sizeof(sample_request) - 1, iterations);
+
+    int expected = bench_legacy(iterations);
+    http_scan_level_t levels[] = { HTTP_SCAN_SCALAR, HTTP_SCAN_SSE42, HTTP_SCAN_AVX2 };
+
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        int headers = bench_current(iterations, levels[i]);
+        if (headers >= 0 && headers != expected) {
+            printf("Numero di header diverso: %d invece di %d\n", headers, expected);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -4,9 +4,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 #include "hiredis/hiredis.h"
 #include <pthread.h>
 #include <semaphore.h>
+#include "json_writer.h"
+#include "msgpack.h"
 
 #define REDIS_HOST "127.0.0.1"
 #define REDIS_PORT 6379
@@ -18,27 +21,40 @@ typedef struct {
     double price;
 } Book;
 
+// Formato del body di un libro, scelto con Content-Type e Accept
+typedef enum {
+    BOOK_FORMAT_JSON,
+    BOOK_FORMAT_MSGPACK
+} book_format_t;
+
+// Primo errore trovato nel body (JSON o MessagePack) di un libro
 typedef struct {
-    redisContext **connections;
-    int size;
-    int current;
-    pthread_mutex_t mutex;
-} redis_pool_t;
+    size_t position;            // Offset nel testo
+    const char *message;
+} book_parse_error_t;
 
 redisContext* connect_redis();
-int init_redis_pool(int pool_size, redis_pool_t * redis_pool);
-redisContext* get_redis_connection();
 
 int save_book(redisContext *c, const Book *book);
+int format_save_book(char **command, const Book *book);
+int save_book_reply(const Book *book, const redisReply *reply);
 Book* load_book(redisContext *c, int book_id);
+int format_load_book(char **command, int book_id);
+int load_book_reply(const redisReply *reply, Book *book);
 int update_book_price(redisContext *c, int book_id, double new_price);
+int format_update_book_price(char **command, int book_id, double new_price);
+int update_book_price_reply(int book_id, double new_price, const redisReply *reply);
 int book_exists(redisContext *c, int book_id);
 int delete_book(redisContext *c, int book_id);
+int format_delete_book(char **command, int book_id);
+int delete_book_reply(int book_id, const redisReply *reply);
 char* get_book_field(redisContext *c, int book_id, const char *field) ;
 void print_book(const Book *book) ;
-char* book_trim_whitespace(char* str);
-char* extract_string_value(char* json, const char* key);
-double extract_numeric_value(char* json, const char* key);
-int parse_book_json(const char* json_string, Book* book);
+int parse_book_json(const char *json, size_t length, Book *book, book_parse_error_t *error);
+void write_book_json(json_writer_t *writer, const Book *book);
+void write_books_json(json_writer_t *writer, const Book *books, size_t count);
+int parse_book_msgpack(const char *data, size_t length, Book *book, book_parse_error_t *error);
+void write_book_msgpack(msgpack_writer_t *writer, const Book *book);
+void write_books_msgpack(msgpack_writer_t *writer, const Book *books, size_t count);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+// book_cache.h
+
+#ifndef BOOK_CACHE_H
+#define BOOK_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "book.h"
+
+#define BOOK_CACHE_SHARD_BITS 4
+#define BOOK_CACHE_SHARDS (1 << BOOK_CACHE_SHARD_BITS)     // Un mutex per shard
+
+// Voce della cache: sta insieme nella catena del bucket e nella lista LRU
+typedef struct book_cache_entry {
+    Book book;
+    uint64_t expires_ms;
+    struct book_cache_entry *hash_next;
+    struct book_cache_entry *lru_prev;  // Verso le voci usate più di recente
+    struct book_cache_entry *lru_next;
+} book_cache_entry_t;
+
+// Una porzione indipendente della cache. Le voci sono allocate tutte
+// all'avvio, quindi la memoria non cresce mai oltre il limite configurato
+typedef struct {
+    pthread_mutex_t mutex;
+    book_cache_entry_t **buckets;
+    uint32_t bucket_mask;
+    book_cache_entry_t *entries;
+    book_cache_entry_t *free_list;
+    book_cache_entry_t *lru_head;       // Usata più di recente
+    book_cache_entry_t *lru_tail;       // Prima candidata all'eviction
+    int count;
+    int capacity;
+
+    // Cresce a ogni invalidazione: una lettura da Redis partita prima non
+    // può più riempire lo shard con un valore vecchio
+    uint64_t version;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t expirations;
+} book_cache_shard_t;
+
+typedef struct {
+    book_cache_shard_t shards[BOOK_CACHE_SHARDS];
+    bool enabled;
+    uint64_t ttl_ms;
+} book_cache_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t expirations;
+    int entries;
+    int capacity;
+} book_cache_stats_t;
+
+// Cache dei libri letti da Redis, condivisa da worker e reactor. A zero
+// (prima di book_cache_init o con dimensione 0) è disabilitata e ogni
+// lookup è un miss che non viene contato
+extern book_cache_t book_cache;
+
+int book_cache_init(book_cache_t *cache, size_t max_bytes, int ttl_seconds);
+void book_cache_destroy(book_cache_t *cache);
+bool book_cache_get(book_cache_t *cache, int book_id, Book *book, uint64_t *version);
+void book_cache_fill(book_cache_t *cache, const Book *book, uint64_t version);
+void book_cache_invalidate(book_cache_t *cache, int book_id);
+void book_cache_stats(book_cache_t *cache, book_cache_stats_t *stats);
+
+#endif
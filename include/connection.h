@@ -0,0 +1,112 @@
+// connection.h
+
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "http_utils.h"
+#include "timer_wheel.h"
+
+#define CONNECTION_READ_CHUNK 4096
+// Input in pipeline oltre il quale si smette di leggere finché la risposta
+// precedente non è stata elaborata e inviata (client che non legge)
+#define CONNECTION_PIPELINE_LIMIT (64 * 1024)
+
+// Numero massimo di buffer passati a una singola writev
+#define CONNECTION_MAX_IOV 64
+
+// Esiti di connection_flush_output
+#define CONNECTION_FLUSH_DONE 0
+#define CONNECTION_FLUSH_AGAIN 1
+
+struct reactor;
+
+// Timeout attualmente armato sulla connessione, dedotto dal suo stato
+typedef enum {
+    CONNECTION_TIMER_NONE,      // Richiesta in mano ai worker o connessione in chiusura
+    CONNECTION_TIMER_IDLE,      // Keep-alive in attesa di una nuova richiesta
+    CONNECTION_TIMER_HEADER,    // Request line e header in arrivo
+    CONNECTION_TIMER_BODY,      // Body in arrivo
+    CONNECTION_TIMER_WRITE      // Risposta in attesa che il client legga
+} connection_timer_t;
+
+// Risposta in attesa di essere scritta sul socket
+typedef struct output_entry {
+    http_response_t *response;
+    size_t offset;                  // Byte della risposta già inviati
+    struct output_entry *next;
+} output_entry_t;
+
+// Stato associato a ogni client connesso, indicizzato per file descriptor.
+// Il reactor che possiede la connessione è l'unico a toccarla, tranne che
+// per la richiesta in mano a un worker (in_flight), la cui risposta torna
+// al reactor tramite completed_response.
+typedef struct connection {
+    int fd;
+    struct reactor *reactor;        // Reactor (istanza epoll) che gestisce il fd
+    int requests_served;            // Richieste già servite su questa connessione
+    uint32_t epoll_events;          // Eventi attualmente registrati in epoll
+
+    bool in_flight;                 // Una richiesta è in mano ai worker
+    bool close_after_write;         // Chiudere appena la coda di output è vuota
+    bool closing;                   // Client perso mentre la richiesta era in_flight
+
+    // Buffer di ricezione: contiene i byte non ancora consumati a partire
+    // dall'inizio della richiesta in corso
+    char *in_buf;
+    size_t in_len;
+    size_t in_cap;
+
+    // Parsing della richiesta in corso, ripreso a ogni nuovo segmento. Il
+    // parser scrive direttamente nel nodo che verrà accodato ai worker
+    http_parser_t parser;
+    struct client_request_node_t *request_node;
+
+    // Coda delle risposte da inviare, svuotata con writev
+    output_entry_t *out_head;
+    output_entry_t *out_tail;
+
+    // Timeout della fase in corso: il timer resta armato finché la fase non
+    // cambia, quindi un client che manda un byte alla volta non lo rinnova
+    timer_entry_t timer;
+    connection_timer_t timer_kind;
+
+    // Stato del backend io_uring: operazioni inviate al ring che fanno ancora
+    // riferimento alla connessione, che non può essere liberata prima
+    int uring_pending;
+    bool recv_armed;                // Recv multishot attiva sul socket
+    bool recv_canceling;            // Cancellazione della recv richiesta
+    bool send_armed;                // Send della testa della coda in corso
+    struct msghdr send_msg;         // Sendmsg in corso: il kernel lo legge fino al completamento
+    struct iovec send_iov[HTTP_RESPONSE_IOV];
+    bool close_queued;              // Close inviata al ring, non ancora completata
+    bool fd_closed;                 // Close eseguita dal ring
+
+    // Richiesta completa che non ha trovato posto nella coda dei worker
+    // (politica pause): resta qui finché il reactor non riesce ad accodarla
+    struct client_request_node_t *stalled_node;
+    struct connection *next_stalled;
+
+    // Risposta prodotta dal worker e lista delle connessioni completate del reactor
+    http_response_t *completed_response;
+    bool completed_keep_alive;
+    struct connection *next_completed;
+} connection_t;
+
+int init_connection_table(int max_fds, size_t max_body_size);
+connection_t* connection_open(int fd, struct reactor *reactor);
+connection_t* connection_get(int fd);
+void connection_close(connection_t *conn);
+void connection_release(connection_t *conn);
+int connection_reserve_input(connection_t *conn, size_t needed);
+char* connection_detach_input(connection_t *conn, size_t length);
+int connection_queue_output(connection_t *conn, http_response_t *response);
+int connection_flush_output(connection_t *conn);
+void connection_output_sent(connection_t *conn, size_t written);
+
+#endif
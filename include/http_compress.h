@@ -0,0 +1,30 @@
+// http_compress.h
+
+#ifndef HTTP_COMPRESS_H
+#define HTTP_COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zlib.h>
+#include "http_utils.h"
+
+// Stato di compressione di un worker: gli stream zlib vengono creati al
+// primo uso e poi solo azzerati con deflateReset, insieme al buffer di uscita
+typedef struct {
+    int level;                  // Livello zlib 1-9, 0 = compressione disabilitata
+    size_t min_size;            // Body più piccoli vengono inviati così come sono
+
+    z_stream gzip;
+    z_stream deflate;
+    bool gzip_ready;
+    bool deflate_ready;
+
+    unsigned char *buffer;
+    size_t capacity;
+} http_compressor_t;
+
+void http_compressor_init(http_compressor_t *compressor, int level, size_t min_size);
+void http_compressor_destroy(http_compressor_t *compressor);
+int http_compress_response(http_compressor_t *compressor, const http_request_t *request, http_response_t *response);
+
+#endif
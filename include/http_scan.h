@@ -0,0 +1,30 @@
+// http_scan.h
+
+#ifndef HTTP_SCAN_H
+#define HTTP_SCAN_H
+
+#include <stddef.h>
+
+// Implementazioni disponibili per la ricerca dei delimitatori HTTP
+typedef enum {
+    HTTP_SCAN_SCALAR,
+    HTTP_SCAN_SSE42,
+    HTTP_SCAN_AVX2
+} http_scan_level_t;
+
+// Ritorna il primo byte in [p, end) uguale ad a o a b, end se non c'è
+typedef const char* (*http_scan_fn)(const char *p, const char *end, char a, char b);
+
+// Versione scelta da http_scan_init; prima dell'init è quella scalare
+extern http_scan_fn http_scan_impl;
+
+void http_scan_init(void);
+int http_scan_select(http_scan_level_t level);
+http_scan_level_t http_scan_level(void);
+const char* http_scan_level_name(http_scan_level_t level);
+
+static inline const char* http_scan_find(const char *p, const char *end, char a, char b) {
+    return http_scan_impl(p, end, a, b);
+}
+
+#endif
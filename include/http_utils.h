@@ -5,27 +5,50 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
+#include <sys/uio.h>
 
 // Costanti
 #define MAX_METHOD_LEN 16
 #define MAX_URI_LEN 2048
 #define MAX_VERSION_LEN 16
 #define MAX_HEADER_NAME_LEN 256
-#define MAX_HEADER_VALUE_LEN 1024
 #define MAX_HEADERS 50
 #define MAX_QUERY_PARAMS 50
 #define MAX_PARAM_NAME_LEN 256
 #define MAX_PARAM_VALUE_LEN 1024
 #define MAX_STATUS_MESSAGE_LEN 256
-#define MAX_RESPONSE_SIZE 65536
-
-// Struct per gli header HTTP
-typedef struct {
-    char name[MAX_HEADER_NAME_LEN];
-    char value[MAX_HEADER_VALUE_LEN];
-} http_header_t;
+#define HTTP_RESPONSE_ARENA_SIZE 1024        // Capacità iniziale dell'arena di una risposta
+#define HTTP_RESPONSE_POOL_MAX 1024         // Risposte tenute da parte per il riuso
+#define HTTP_RESPONSE_POOL_MAX_BUFFER 65536 // Buffer più grandi non tornano nel pool
+#define HTTP_RESPONSE_IOV 3                 // Status line, headers, body
+#define HTTP_DATE_LENGTH 29                 // "Sun, 06 Nov 1994 08:49:37 GMT"
+#define HTTP_DATE_SLOTS 8                   // Copie della data in cache, una per secondo
+#define HTTP_MAX_HEADER_SECTION 16384       // Request line + headers
+#define HTTP_MAX_BODY_SIZE (1024 * 1024)        // Default di http_parser_t.max_body_size
+#define HTTP_MAX_CHUNK_LINE 1024                // Riga con la dimensione di un chunk (ed estensioni)
 
+// Header noti: richieste e risposte ne tengono la posizione in uno slot
+// fisso, così leggerli o aggiornarli non richiede di scorrere la lista
+typedef enum {
+    HTTP_HEADER_HOST,
+    HTTP_HEADER_ACCEPT,
+    HTTP_HEADER_DATE,
+    HTTP_HEADER_ETAG,
+    HTTP_HEADER_VARY,
+    HTTP_HEADER_SERVER,
+    HTTP_HEADER_CONNECTION,
+    HTTP_HEADER_CONTENT_TYPE,
+    HTTP_HEADER_IF_NONE_MATCH,
+    HTTP_HEADER_CONTENT_LENGTH,
+    HTTP_HEADER_ACCEPT_ENCODING,
+    HTTP_HEADER_CONTENT_ENCODING,
+    HTTP_HEADER_TRANSFER_ENCODING,
+    HTTP_KNOWN_HEADER_COUNT,
+    HTTP_HEADER_UNKNOWN = HTTP_KNOWN_HEADER_COUNT
+} http_known_header_t;
 
 typedef enum {
     HTTP_OK = 200,
@@ -41,6 +64,8 @@ typedef enum {
     HTTP_NOT_FOUND = 404,
     HTTP_METHOD_NOT_ALLOWED = 405,
     HTTP_CONFLICT = 409,
+    HTTP_PAYLOAD_TOO_LARGE = 413,
+    HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE = 431,
     HTTP_INTERNAL_SERVER_ERROR = 500,
     HTTP_NOT_IMPLEMENTED = 501,
     HTTP_BAD_GATEWAY = 502,
@@ -48,21 +73,64 @@ typedef enum {
 } http_status_t;
 
 
-// Struct per la risposta HTTP
+// Header di una risposta: nome e valore stanno nell'arena, terminati da '\0'
+typedef struct {
+    uint32_t name;
+    uint32_t value;
+    uint32_t name_length;
+    uint32_t value_length;
+} http_response_header_t;
+
+// Body costante con i suoi Content-Length e Content-Type già serializzati:
+// preparato una volta all'avvio, finisce nella risposta con una memcpy
 typedef struct {
-    char version[MAX_VERSION_LEN];
+    const char *body;
+    size_t body_length;
+    char headers[128];
+    size_t headers_length;
+} http_prebuilt_body_t;
+
+// Struct per la risposta HTTP. Header e body vengono copiati in un'arena
+// propria della risposta e referenziati per offset, così l'arena può
+// crescere con realloc. build_response non concatena nulla: prepara un
+// iovec con la status line pre-renderizzata, gli headers serializzati in
+// head e il body, inviati poi con writev/sendmsg. Le risposte liberate
+// tornano in un pool e al riuso arena e buffer si azzerano in O(1).
+// Date, Server e Connection non passano dalla lista degli header: vengono
+// scritti da build_response con byte costanti e la data in cache, a meno
+// che un handler non li imposti con add_response_header.
+typedef struct http_response {
     http_status_t status_code;
-    char status_message[MAX_STATUS_MESSAGE_LEN];
-    
-    http_header_t headers[MAX_HEADERS];
+    const char *status_message;
+
+    http_response_header_t headers[MAX_HEADERS];
     int header_count;
-    
-    char *body;
+    uint8_t known_headers[HTTP_KNOWN_HEADER_COUNT];    // Indice + 1 in headers, 0 se assente
+
+    uint32_t body;              // Offset del body nell'arena
     size_t body_length;
-    
-    // Buffer per la risposta completa
-    char *raw_response;
-    size_t raw_response_size;
+
+    char *arena;
+    size_t arena_used;
+    size_t arena_capacity;
+
+    // Body non copiato (stringhe statiche, dati in cache): deve restare
+    // valido finché la risposta non viene liberata
+    const char *body_ref;
+    const http_prebuilt_body_t *prebuilt;
+
+    int8_t keep_alive;          // Header Connection: -1 assente, 0 close, 1 keep-alive
+
+    // Headers serializzati (e la status line se non è pre-renderizzata)
+    char *head;
+    size_t head_capacity;
+
+    // Risposta pronta per l'invio, valida dopo build_response
+    struct iovec iov[HTTP_RESPONSE_IOV];
+    int iov_count;
+    size_t response_size;
+
+    struct http_response *next_free;
 } http_response_t;
 
 
@@ -80,51 +148,121 @@ typedef enum {
     HTTP_UNKNOWN
 } http_method_t;
 
-// Struct per i parametri query
+// Porzione del buffer della richiesta. Request line e headers stanno nei
+// primi HTTP_MAX_HEADER_SECTION byte, quindi bastano 16 bit per entrambi i campi.
+// Il parser termina ogni campo con '\0' in place: buffer + offset è una stringa C
+typedef struct {
+    uint16_t offset;
+    uint16_t length;
+} http_view_t;
+
+// Header e parametri query della richiesta: nome e valore puntano nel buffer
+typedef struct {
+    http_view_t name;
+    http_view_t value;
+} http_header_view_t;
+
 typedef struct {
-    char name[MAX_PARAM_NAME_LEN];
-    char value[MAX_PARAM_VALUE_LEN];
+    http_view_t name;
+    http_view_t value;
 } query_param_t;
 
 
-// Struct principale per la richiesta HTTP
+// Struct principale per la richiesta HTTP. Non copia nulla: i campi sono
+// viste sul buffer di ricezione, che dopo il dispatch appartiene alla richiesta
 typedef struct {
+    char *buffer;               // Byte ricevuti, a partire dalla request line
     http_method_t method;
-    char method_str[MAX_METHOD_LEN];
-    char uri[MAX_URI_LEN];
-    char path[MAX_URI_LEN];
-    char query_string[MAX_URI_LEN];
-    char version[MAX_VERSION_LEN];
+    http_view_t method_str;
+    http_view_t path;           // Senza query string
+    http_view_t version;
     
-    http_header_t headers[MAX_HEADERS];
+    http_header_view_t headers[MAX_HEADERS];
     int header_count;
+    uint8_t known_headers[HTTP_KNOWN_HEADER_COUNT];    // Indice + 1 in headers, 0 se assente
     
-    query_param_t query_params[MAX_QUERY_PARAMS];
+    query_param_t query_params[MAX_QUERY_PARAMS];  // Già decodificati
     int query_param_count;
     
-    char *body;
+    char *body;                 // Dentro buffer, terminato da '\0'; NULL se assente
     size_t body_length;
     size_t content_length;
 } http_request_t;
 
+// Stringa C del campo indicato
+static inline const char* http_request_str(const http_request_t *request, http_view_t view) {
+    return request->buffer + view.offset;
+}
+
+// Valore di un header noto (il primo se ripetuto), NULL se assente
+static inline const char* http_request_header(const http_request_t *request, http_known_header_t header) {
+    uint8_t slot = request->known_headers[header];
+    return slot ? http_request_str(request, request->headers[slot - 1].value) : NULL;
+}
+
+// Stati del parser incrementale: una richiesta può arrivare in più segmenti
+// TCP e il parsing riprende dal punto in cui si era fermato
+typedef enum {
+    HTTP_PARSE_REQUEST_LINE,
+    HTTP_PARSE_HEADERS,
+    HTTP_PARSE_BODY,
+    HTTP_PARSE_COMPLETE,
+    HTTP_PARSE_ERROR
+} http_parse_state_t;
+
+// Fasi della decodifica di un body con Transfer-Encoding: chunked
+typedef enum {
+    HTTP_CHUNK_SIZE,         // Riga con la dimensione esadecimale
+    HTTP_CHUNK_DATA,         // Dati del chunk
+    HTTP_CHUNK_DATA_END,     // CRLF che chiude i dati
+    HTTP_CHUNK_TRAILER       // Trailer dopo il chunk finale, fino alla riga vuota
+} http_chunk_state_t;
+
+// Gli offset sono relativi all'inizio del buffer che contiene la richiesta
+typedef struct {
+    http_parse_state_t state;
+    size_t line_start;       // Inizio della riga in corso di parsing
+    size_t scan_pos;         // Da qui riprende la ricerca del prossimo delimitatore
+    size_t colon;            // ':' della riga di header in corso, 0 se non ancora visto
+    size_t body_start;       // Primo byte del body (dopo la riga vuota)
+    size_t request_length;   // Byte occupati dalla richiesta completa
+    size_t max_body_size;    // Oltre questa dimensione la richiesta è rifiutata (413)
+    http_status_t error;     // Risposta da dare quando state è HTTP_PARSE_ERROR
+
+    // Body chunked: i dati vengono compattati in place a partire da
+    // body_start, quindi la richiesta vede comunque un body contiguo
+    bool chunked;
+    http_chunk_state_t chunk_state;
+    size_t chunk_remaining;  // Byte ancora da leggere nel chunk corrente
+} http_parser_t;
+
 // Funzioni di utility
 const char* status_to_message(http_status_t status);
-char* get_current_time_string();
-const char* status_to_message(http_status_t status);
+void http_date_refresh(void);
+const char* http_date(void);
 http_method_t string_to_method(const char *method_str);
+http_method_t http_method_lookup(const char *name, size_t length);
 const char* method_to_string(http_method_t method);
+http_known_header_t http_header_lookup(const char *name, size_t length);
+int http_header_quality(const char *header, const char *value);
 void trim_whitespace(char *str);
-int parse_request_line(const char *line, http_request_t *request);
-int parse_header_line(const char *line, http_request_t *request);
-int parse_query_string(const char *query_string, http_request_t *request);
+int parse_request_line(char *data, size_t start, size_t end, http_request_t *request);
+int parse_header_line(char *data, size_t start, size_t end, http_request_t *request);
+int parse_query_string(char *data, size_t start, size_t end, http_request_t *request);
 void url_decode(char *dst, const char *src);
 int hex_to_int(char c);
 
 
 // Funzioni principali
 http_request_t* create_http_request();
+void http_request_init(http_request_t *request);
+void http_request_set_buffer(http_request_t *request, char *buffer, size_t body_start);
+void http_request_clear(http_request_t *request);
 void free_http_request(http_request_t *request);
 int parse_http_request(const char *raw_request, http_request_t *request);
+void http_parser_init(http_parser_t *parser);
+http_parse_state_t http_parser_execute(http_parser_t *parser, http_request_t *request, char *data, size_t length);
+size_t http_parser_compact(http_parser_t *parser, const http_request_t *request, char *data, size_t length);
 void print_http_request(const http_request_t *request);
 
 // Funzioni di accesso
@@ -132,18 +270,34 @@ const char* get_header_value(const http_request_t *request, const char *header_n
 const char* get_query_param(const http_request_t *request, const char *param_name);
 int has_header(const http_request_t *request, const char *header_name);
 int has_query_param(const http_request_t *request, const char *param_name);
+int http_request_keep_alive(const http_request_t *request);
 
 // Funzioni per le risposte
 http_response_t* create_http_response();
 void free_http_response(http_response_t *response);
 int set_response_status(http_response_t *response, http_status_t status);
 int add_response_header(http_response_t *response, const char *name, const char *value);
+int add_response_vary(http_response_t *response, const char *field);
+int set_response_keep_alive(http_response_t *response, int keep_alive);
+// Body della risposta, copiato nell'arena o referenziato da body_ref
+static inline const char* http_response_body(const http_response_t *response) {
+    return response->body_ref ? response->body_ref : response->arena + response->body;
+}
+
 int set_response_body(http_response_t *response, const char *body, const char *content_type);
+int set_response_body_length(http_response_t *response, const char *body, size_t length, const char *content_type);
+int set_response_body_ref(http_response_t *response, const char *body, size_t length, const char *content_type);
+int http_prebuilt_body_init(http_prebuilt_body_t *prebuilt, const char *body, const char *content_type);
+int set_response_prebuilt_body(http_response_t *response, const http_prebuilt_body_t *prebuilt);
+void http_response_body_begin(http_response_t *response);
+char* http_response_body_reserve(http_response_t *response, size_t length);
+void http_response_body_commit(http_response_t *response, size_t length);
+int http_response_body_end(http_response_t *response, const char *content_type);
 int set_response_json(http_response_t *response, const char *json);
 int set_response_html(http_response_t *response, const char *html);
 int set_response_text(http_response_t *response, const char *text);
 int build_response(http_response_t *response);
-const char* get_response_string(http_response_t *response);
+int http_response_iov(const http_response_t *response, size_t offset, struct iovec *iov, int max_iov);
 void print_http_response(const http_response_t *response);
 
 http_response_t* create_http_response();
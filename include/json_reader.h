@@ -0,0 +1,35 @@
+// json_reader.h
+
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define JSON_MAX_DEPTH 32           // Annidamento massimo dei valori saltati
+#define JSON_MAX_NUMBER_LEN 64
+
+// Lettore JSON a passata singola sul testo originale: non alloca memoria e
+// non modifica l'input. Al primo errore si ferma e ricorda posizione e
+// motivo; le chiamate successive falliscono subito.
+typedef struct {
+    const char *start;
+    const char *p;
+    const char *end;
+    const char *error;          // Messaggio statico, NULL se nessun errore
+    size_t error_position;      // Offset dall'inizio del testo
+} json_reader_t;
+
+void json_reader_init(json_reader_t *reader, const char *text, size_t length);
+bool json_reader_fail(json_reader_t *reader, const char *message);
+
+char json_peek(json_reader_t *reader);
+bool json_expect(json_reader_t *reader, char c);
+bool json_object_next(json_reader_t *reader, bool *first);
+bool json_read_key(json_reader_t *reader, char *key, size_t size, size_t *length);
+bool json_read_string(json_reader_t *reader, char *out, size_t size, size_t *length);
+bool json_read_number(json_reader_t *reader, double *value);
+bool json_skip_value(json_reader_t *reader);
+bool json_expect_end(json_reader_t *reader);
+
+#endif
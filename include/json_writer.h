@@ -0,0 +1,44 @@
+// json_writer.h
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "http_utils.h"
+
+#define JSON_WRITER_MAX_DEPTH 32    // Livelli di oggetti/array aperti
+#define JSON_DOUBLE_MAX_LEN 32      // "-1.2345678901234567e-308" e simili
+
+// Scrittore JSON compatto che accoda direttamente al body di una risposta,
+// senza buffer intermedi. Virgole e separatori sono gestiti dal writer; al
+// primo errore (memoria, annidamento) le chiamate successive non fanno nulla
+// e json_writer_finish ritorna -1.
+typedef struct {
+    http_response_t *response;
+    uint32_t has_items;         // Bit i: il livello i contiene già un valore
+    int depth;
+    bool after_key;             // Il prossimo valore segue una chiave, niente virgola
+    bool failed;
+} json_writer_t;
+
+void json_writer_init(json_writer_t *writer, http_response_t *response);
+int json_writer_finish(json_writer_t *writer);
+
+void json_begin_object(json_writer_t *writer);
+void json_end_object(json_writer_t *writer);
+void json_begin_array(json_writer_t *writer);
+void json_end_array(json_writer_t *writer);
+void json_key(json_writer_t *writer, const char *key);
+
+void json_string(json_writer_t *writer, const char *value, size_t length);
+void json_cstring(json_writer_t *writer, const char *value);
+void json_int(json_writer_t *writer, long long value);
+void json_double(json_writer_t *writer, double value);
+void json_bool(json_writer_t *writer, bool value);
+void json_null(json_writer_t *writer);
+
+int json_format_double(char *out, double value);
+
+#endif
@@ -0,0 +1,55 @@
+// msgpack.h
+
+#ifndef MSGPACK_H
+#define MSGPACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "http_utils.h"
+
+#define MSGPACK_CONTENT_TYPE "application/msgpack"
+#define MSGPACK_MAX_DEPTH 32        // Annidamento massimo dei valori saltati
+
+// Lettore MessagePack sul buffer originale: le stringhe vengono restituite
+// come puntatore e lunghezza dentro l'input, senza copie né allocazioni.
+// Come json_reader_t si ferma al primo errore e ne ricorda posizione e motivo.
+typedef struct {
+    const unsigned char *start;
+    const unsigned char *p;
+    const unsigned char *end;
+    const char *error;          // Messaggio statico, NULL se nessun errore
+    size_t error_position;      // Offset dall'inizio dei dati
+} msgpack_reader_t;
+
+void msgpack_reader_init(msgpack_reader_t *reader, const char *data, size_t length);
+bool msgpack_reader_fail(msgpack_reader_t *reader, const char *message);
+
+bool msgpack_read_map(msgpack_reader_t *reader, uint32_t *count);
+bool msgpack_read_array(msgpack_reader_t *reader, uint32_t *count);
+bool msgpack_read_str(msgpack_reader_t *reader, const char **data, uint32_t *length);
+bool msgpack_read_int(msgpack_reader_t *reader, int64_t *value);
+bool msgpack_read_number(msgpack_reader_t *reader, double *value);
+bool msgpack_skip_value(msgpack_reader_t *reader);
+bool msgpack_expect_end(msgpack_reader_t *reader);
+
+// Scrittore MessagePack che accoda al body di una risposta, come
+// json_writer_t; mappe e array dichiarano in anticipo il numero di elementi
+typedef struct {
+    http_response_t *response;
+    bool failed;
+} msgpack_writer_t;
+
+void msgpack_writer_init(msgpack_writer_t *writer, http_response_t *response);
+int msgpack_writer_finish(msgpack_writer_t *writer);
+
+void msgpack_write_map(msgpack_writer_t *writer, uint32_t count);
+void msgpack_write_array(msgpack_writer_t *writer, uint32_t count);
+void msgpack_write_str(msgpack_writer_t *writer, const char *data, size_t length);
+void msgpack_write_cstr(msgpack_writer_t *writer, const char *value);
+void msgpack_write_int(msgpack_writer_t *writer, int64_t value);
+void msgpack_write_double(msgpack_writer_t *writer, double value);
+void msgpack_write_bool(msgpack_writer_t *writer, bool value);
+void msgpack_write_nil(msgpack_writer_t *writer);
+
+#endif
@@ -0,0 +1,32 @@
+// redis_async.h
+
+#ifndef REDIS_ASYNC_H
+#define REDIS_ASYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hiredis/hiredis.h"
+#include "hiredis/async.h"
+
+// Client hiredis asincrono di un reactor (--redis-async): il socket verso
+// Redis è registrato nella stessa istanza epoll dei client e i comandi non
+// bloccano mai il thread. Le risposte arrivano alle callback passate a
+// redisAsyncFormattedCommand, nell'ordine dei comandi
+typedef struct {
+    redisAsyncContext *context;     // NULL se disconnesso
+    int epoll_fd;
+    int fd;                         // Socket registrato in epoll, -1 se nessuno
+    uint32_t events;                // Eventi richiesti da hiredis
+    bool connected;                 // Connessione stabilita, non solo avviata
+    uint64_t retry_at_ms;           // Prima di questo istante non si riprova a connettersi
+    int backoff_ms;
+    const char *host;
+    int port;
+} redis_async_t;
+
+void redis_async_init(redis_async_t *redis, int epoll_fd, const char *host, int port);
+void redis_async_destroy(redis_async_t *redis);
+redisAsyncContext* redis_async_context(redis_async_t *redis);
+void redis_async_handle_events(redis_async_t *redis, uint32_t events);
+
+#endif
@@ -0,0 +1,49 @@
+// redis_pool.h
+
+#ifndef REDIS_POOL_H
+#define REDIS_POOL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <semaphore.h>
+#include "hiredis/hiredis.h"
+
+#define REDIS_CONNECT_TIMEOUT_MS 1000
+#define REDIS_COMMAND_TIMEOUT_MS 1000           // Attesa massima di una risposta, PING compreso
+#define REDIS_HEALTH_CHECK_INTERVAL_MS 5000     // Oltre questa inattività si fa PING prima dell'uso
+#define REDIS_BACKOFF_MIN_MS 100
+#define REDIS_BACKOFF_MAX_MS 5000
+
+// Una connessione del pool. Chi la prende con redis_pool_checkout ne è
+// l'unico utilizzatore finché non la restituisce: hiredis non permette di
+// usare lo stesso redisContext da più thread
+typedef struct {
+    redisContext *context;      // NULL se disconnessa
+    atomic_uint next;           // Prossimo slot libero (indice + 1), 0 = fine lista
+    uint64_t last_used_ms;      // Ultimo uso riuscito, per il health check
+    uint64_t retry_at_ms;       // Prima di questo istante non si riprova a connettersi
+    int backoff_ms;             // Attesa dopo il prossimo tentativo fallito
+} redis_slot_t;
+
+// Pool con la lista libera lock-free (stack di Treiber). La testa porta un
+// contatore di versione nei 32 bit alti contro il problema ABA; il semaforo
+// conta gli slot liberi. Il pool non è lock-free: checkout si blocca in
+// sem_wait a pool esaurito, ma nel caso normale costa qualche operazione
+// atomica, senza mutex
+typedef struct {
+    redis_slot_t *slots;
+    int size;
+    _Atomic uint64_t free_head;     // (versione << 32) | (indice + 1)
+    sem_t available;
+    const char *host;
+    int port;
+} redis_pool_t;
+
+int redis_pool_init(redis_pool_t *pool, int size, const char *host, int port);
+void redis_pool_destroy(redis_pool_t *pool);
+redis_slot_t* redis_pool_checkout(redis_pool_t *pool);
+void redis_pool_checkin(redis_pool_t *pool, redis_slot_t *slot);
+redisContext* redis_slot_context(redis_pool_t *pool, redis_slot_t *slot);
+
+#endif
@@ -11,9 +11,11 @@
 #include <semaphore.h>
 
 #include "http_utils.h"
+#include "connection.h"
 
 typedef struct client_request_node_t{   
     int client_fd;
+    connection_t *connection;
     http_request_t request;
     struct client_request_node_t*next;
 }client_request_node_t;
@@ -38,14 +40,18 @@ typedef struct {
 } request_queue_t;
 
 request_queue_t* createQueue(int maxSize);
+client_request_node_t* create_request_node(void);
+void free_request_node(client_request_node_t *node);
 bool isEmpty(request_queue_t* q);
 bool isEmptyUnsafe(request_queue_t* q);
 bool isFullUnsafe(request_queue_t* q);
 int getSize(request_queue_t* q);
 bool enqueue(request_queue_t* q, http_request_t *request);
 bool dequeue(request_queue_t* q, http_request_t* request);
-bool dequeue_node(request_queue_t* q, client_request_node_t* node);
+client_request_node_t* dequeue_node(request_queue_t* q);
+int dequeue_batch(request_queue_t* q, client_request_node_t** nodes, int max, int linger_us);
 bool enqueue_node(request_queue_t* q, client_request_node_t* node);
+bool try_enqueue_node(request_queue_t* q, client_request_node_t* node);
 
 bool peek(request_queue_t* q, http_request_t* request);
 bool peekRear(request_queue_t* q, http_request_t* request);
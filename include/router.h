@@ -0,0 +1,69 @@
+// router.h
+
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <stddef.h>
+#include "http_utils.h"
+
+#define ROUTER_MAX_PARAMS 8
+
+// Esiti di route_param_int oltre allo 0 di successo
+#define ROUTE_PARAM_MISSING (-1)
+#define ROUTE_PARAM_INVALID (-2)
+
+// Segmento catturato da un pattern come /books/{id}: value punta dentro il
+// path della richiesta e non è terminato da '\0'
+typedef struct {
+    const char *name;
+    const char *value;
+    size_t length;
+} route_param_t;
+
+typedef struct {
+    route_param_t items[ROUTER_MAX_PARAMS];
+    int count;
+} route_params_t;
+
+typedef void (*route_handler_fn)(const http_request_t *request, const route_params_t *params,
+                                 http_response_t *response, void *context);
+
+// Voce della tabella delle route: method + pattern (segmenti statici e {nome})
+typedef struct {
+    http_method_t method;
+    const char *pattern;
+    route_handler_fn handler;
+} route_t;
+
+typedef enum {
+    ROUTER_MATCH,
+    ROUTER_NOT_FOUND,
+    ROUTER_METHOD_NOT_ALLOWED
+} router_result_t;
+
+typedef struct {
+    route_handler_fn handler;
+    route_params_t params;
+    unsigned int allowed_methods;   // Bitmask (1 << http_method_t) dei metodi del path
+} route_match_t;
+
+struct router_node;
+
+// Radix tree costruito all'avvio e poi solo letto: più thread possono
+// cercare in parallelo senza lock
+typedef struct {
+    struct router_node *root;
+} router_t;
+
+int router_init(router_t *router);
+int router_add(router_t *router, http_method_t method, const char *pattern, route_handler_fn handler);
+int router_add_routes(router_t *router, const route_t *routes, size_t count);
+router_result_t router_match(const router_t *router, http_method_t method, const char *path,
+                             size_t length, route_match_t *match);
+int router_allow_header(unsigned int allowed_methods, char *buffer, size_t size);
+void router_destroy(router_t *router);
+
+const char* route_param(const route_params_t *params, const char *name, size_t *length);
+int route_param_int(const route_params_t *params, const char *name, int *value);
+
+#endif
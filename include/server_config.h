@@ -0,0 +1,108 @@
+// server_config.h
+
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Valori di default della configurazione
+#define DEFAULT_SERVER_PORT 8080
+#define DEFAULT_WORKER_THREADS 10
+#define DEFAULT_KEEPALIVE_MAX_REQUESTS 100
+#define DEFAULT_REACTORS 1
+#define DEFAULT_MAX_EVENTS 64
+#define DEFAULT_QUEUE_SIZE 256
+#define DEFAULT_RETRY_AFTER 1
+#define DEFAULT_HEADER_TIMEOUT 10
+#define DEFAULT_BODY_TIMEOUT 30
+#define DEFAULT_IDLE_TIMEOUT 60
+#define DEFAULT_WRITE_TIMEOUT 30
+#define DEFAULT_MAX_BODY_SIZE (1024 * 1024)
+#define DEFAULT_GZIP_LEVEL 6
+#define DEFAULT_GZIP_MIN_SIZE 1024
+#define DEFAULT_REDIS_POOL_SIZE 10
+#define DEFAULT_BATCH_SIZE 16
+#define MAX_BATCH_SIZE 64
+#define DEFAULT_BATCH_LINGER_US 0
+#define DEFAULT_BOOK_CACHE_SIZE (8 * 1024 * 1024)
+#define DEFAULT_BOOK_CACHE_TTL 60
+
+// Cosa fa il reactor quando la coda dei worker è piena
+typedef enum {
+    OVERLOAD_PAUSE,     // Smette di leggere dal client finché la coda non si libera
+    OVERLOAD_REJECT     // Risponde subito 503 Service Unavailable con Retry-After
+} overload_policy_t;
+
+typedef struct {
+    int port;
+    int worker_threads;
+
+    // Numero di event loop, ciascuno su un proprio thread con epoll e
+    // socket in ascolto (SO_REUSEPORT) dedicati
+    int reactors;
+
+    // Dimensione dell'array di eventi passato a epoll_wait
+    int max_events;
+    // Registra i socket con EPOLLET e svuota accept/recv fino a EAGAIN
+    bool edge_triggered;
+    // Usa il backend io_uring (accept/recv multishot) al posto di epoll
+    bool io_uring;
+
+    // Capacità della coda verso i worker e comportamento quando è piena:
+    // il reactor non si blocca mai in attesa di uno slot
+    int queue_size;
+    overload_policy_t overload_policy;
+    int retry_after;            // Secondi indicati nell'header Retry-After delle 503
+
+    // Timeout in secondi (0 = disabilitato): ricezione di request line e
+    // header, ricezione del body, attesa tra una richiesta e l'altra e
+    // invio della risposta a un client che non legge
+    int header_timeout;
+    int body_timeout;
+    int idle_timeout;
+    int write_timeout;
+
+    // Dimensione massima del body (anche chunked, una volta decodificato):
+    // oltre si risponde 413 Payload Too Large
+    size_t max_body_size;
+
+    // Compressione gzip/deflate delle risposte, se il client la accetta:
+    // livello zlib (0 = disabilitata) e dimensione minima del body
+    int gzip_level;
+    size_t gzip_min_size;
+
+    // Connessioni Redis nel pool, indipendenti dal numero di worker. Con
+    // redis_pin ogni worker tiene per sé una connessione per tutta la vita
+    int redis_pool_size;
+    bool redis_pin;
+
+    // Group commit: un worker preleva fino a batch_size richieste, accoda i
+    // loro comandi Redis e li invia con una sola scrittura. Con la coda vuota
+    // aspetta al più batch_linger_us microsecondi che il batch si riempia
+    int batch_size;
+    int batch_linger_us;
+
+    // Client Redis asincrono nei reactor: le richieste non passano dai
+    // worker e ogni reactor tiene in volo quanti comandi servono
+    bool redis_async;
+
+    // Cache in memoria dei libri letti: memoria massima in byte (0 =
+    // disabilitata) e secondi dopo cui una voce torna a essere letta da Redis
+    size_t book_cache_size;
+    int book_cache_ttl;
+
+    // Numero massimo di richieste servite su una connessione keep-alive
+    // prima di chiuderla (0 = keep-alive disabilitato)
+    int keepalive_max_requests;
+} server_config_t;
+
+extern server_config_t server_config;
+
+void init_server_config(server_config_t *config);
+int parse_server_config(int argc, char **argv, server_config_t *config);
+void print_server_config(const server_config_t *config);
+
+#endif
@@ -11,14 +11,64 @@
 #include <sys/epoll.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
 #include"requests_queue.h"
+#include "connection.h"
+#include "timer_wheel.h"
 #include "book.h"
+#include "redis_pool.h"
+#include "redis_async.h"
+#include "http_compress.h"
 
 
 #define MAX_CLIENTS 10000
 #define BUFFER_SIZE 2048
 
 
+struct uring;
+
+// Event loop: un'istanza epoll (o un ring io_uring) con il socket in ascolto
+// e l'eventfd su cui i worker segnalano le risposte pronte
+typedef struct reactor {
+    int id;
+    pthread_t thread;
+    int epoll_fd;
+    int listen_fd;      // Socket in ascolto proprio del reactor (SO_REUSEPORT)
+    int event_fd;
+    int spare_fd;       // Descrittore di riserva per scartare connessioni con gli fd esauriti
+
+    struct epoll_event *events;
+    int max_events;
+    bool edge_triggered;    // Socket registrati con EPOLLET e letti fino a EAGAIN
+
+    struct uring *uring;    // Backend io_uring, NULL se il reactor usa epoll
+
+    // Chiesto da start_reactors per annullare un avvio fallito; il loop
+    // termina al prossimo risveglio
+    bool stopping;
+
+    // Timeout delle connessioni del reactor, avanzata a ogni giro del loop
+    timer_wheel_t timers;
+
+    // Connessioni con una richiesta in attesa di spazio nella coda dei worker,
+    // toccate solo dal reactor; il contatore è letto dai worker per svegliarlo
+    connection_t *stalled_head;
+    connection_t *stalled_tail;
+    int stalled_count;
+
+    // Con --redis-async il reactor serve da sé le richieste: client Redis
+    // asincrono sulla stessa istanza epoll e compressore delle risposte
+    bool redis_async;
+    redis_async_t redis;
+    http_compressor_t compressor;
+
+    // Connessioni la cui risposta è pronta, riempita dai worker
+    pthread_mutex_t completed_mutex;
+    connection_t *completed_head;
+    connection_t *completed_tail;
+} reactor_t;
+
 // variabili globali
 extern int server_fd;    
 extern int epoll_fd;
@@ -36,14 +86,28 @@ extern redis_pool_t *redis_pool;
 
 // Dichiarazioni delle funzioni
 int set_nonblocking(int sockfd);
-int init_server_socket(int port);
+int init_server_socket(int port, bool reuse_port);
 int init_epoll_istance();
 int add_fd_to_epoll_istance(int fd_to_monitor, int epoll_istance, int event_type);
+int add_client_fd_to_epoll_istance(int fd_to_monitor, int epoll_istance, int event_type);
+int modify_fd_in_epoll_istance(int fd_to_monitor, int epoll_istance, int event_type);
+
+int reactor_init(reactor_t *reactor, int id, int listen_fd);
+reactor_t* start_reactors(int count, int port);
+void reactor_run(reactor_t *reactor);
+void reactor_post_completion(connection_t *conn, http_response_t *response, bool keep_alive);
+connection_t* reactor_take_completions(reactor_t *reactor);
+void reactor_notify_capacity(void);
+int dispatch_connection_request(connection_t *conn);
+void connection_update_timer(connection_t *conn);
+void connection_restart_timer(connection_t *conn);
+const char* connection_timer_name(connection_timer_t kind);
 
-int handle_new_connection(int server_fd, int epoll_fd);
-int handle_client_data(int client_fd);
-int process_epoll_events(int server_fd, int epoll_fd, struct epoll_event *events, int num_events);
+int handle_new_connection(reactor_t *reactor);
+void reactor_shed_connection(reactor_t *reactor);
+int handle_client_data(connection_t *conn);
+int process_epoll_events(reactor_t *reactor, struct epoll_event *events, int num_events);
 void cleanup_resources(int server_fd, int epoll_fd);
-int initialize_server(int port);
+int initialize_server();
 
 #endif
\ No newline at end of file
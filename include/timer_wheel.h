@@ -0,0 +1,44 @@
+// timer_wheel.h
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Risoluzione e numero di slot: un giro della ruota copre
+// TIMER_WHEEL_SLOTS * TIMER_WHEEL_TICK_MS; scadenze più lontane restano
+// nello slot per più giri
+#define TIMER_WHEEL_TICK_MS 100
+#define TIMER_WHEEL_SLOTS 512       // Potenza di 2
+
+struct timer_wheel;
+
+// Timer intrusivo: vive dentro l'oggetto che lo usa (es. la connessione),
+// quindi armarlo e cancellarlo non alloca ed è O(1)
+typedef struct timer_entry {
+    struct timer_entry *prev;
+    struct timer_entry *next;
+    struct timer_wheel *wheel;      // Ruota su cui è armato, NULL se non armato
+    uint64_t expires;               // Tick di scadenza
+    void *data;
+} timer_entry_t;
+
+typedef struct timer_wheel {
+    timer_entry_t slots[TIMER_WHEEL_SLOTS];     // Sentinelle delle liste circolari
+    uint64_t current_tick;
+    uint64_t start_ms;
+    int count;                                  // Timer armati
+} timer_wheel_t;
+
+typedef void (*timer_expire_fn)(timer_entry_t *entry, void *arg);
+
+uint64_t timer_wheel_now_ms(void);
+void timer_wheel_init(timer_wheel_t *wheel);
+void timer_entry_init(timer_entry_t *entry, void *data);
+void timer_wheel_arm(timer_wheel_t *wheel, timer_entry_t *entry, uint64_t timeout_ms);
+void timer_wheel_cancel(timer_entry_t *entry);
+int timer_wheel_next_timeout(timer_wheel_t *wheel);
+void timer_wheel_advance(timer_wheel_t *wheel, timer_expire_fn expire, void *arg);
+
+#endif
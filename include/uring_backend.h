@@ -0,0 +1,24 @@
+// uring_backend.h
+
+#ifndef URING_BACKEND_H
+#define URING_BACKEND_H
+
+#include "server_utils.h"
+
+// Dimensione della submission queue; la completion queue è URING_CQ_FACTOR volte
+// più grande perché accept e recv multishot producono più CQE per SQE
+#define URING_ENTRIES 1024
+#define URING_CQ_FACTOR 4
+
+// Buffer forniti al kernel per le recv (buffer ring, deve essere una potenza
+// di 2). Limitano anche l'input che un client può far arrivare in un solo giro
+// del loop, prima che la sospensione della sua recv abbia effetto
+#define URING_BUFFER_COUNT 128
+#define URING_BUFFER_SIZE CONNECTION_READ_CHUNK
+#define URING_BUFFER_GROUP 0
+
+int uring_reactor_init(reactor_t *reactor);
+void uring_reactor_run(reactor_t *reactor);
+void uring_reactor_destroy(reactor_t *reactor);
+
+#endif
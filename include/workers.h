@@ -8,9 +8,26 @@
 #include <stdbool.h>
 #include "requests_queue.h"
 #include "book.h"
+#include "router.h"
+#include "redis_async.h"
 
 
 
+// Una richiesta tra le due fasi del group commit: l'handler della route
+// valida la richiesta, accoda il suo comando Redis e lascia in complete la
+// funzione che riceverà la risposta dopo il flush unico di tutto il batch
+typedef struct book_call_t book_call_t;
+typedef void (*book_complete_fn)(book_call_t *call, const redisReply *reply, http_response_t *response);
+
+struct book_call_t {
+    redisContext *redis;            // Connessione del worker
+    redisAsyncContext *async;       // Client del reactor con --redis-async, altrimenti NULL
+    const http_request_t *request;
+    Book book;
+    uint64_t cache_version;         // Versione della cache al miss, per riempirla
+    book_complete_fn complete;      // NULL se la risposta è già pronta
+};
+
 typedef struct {
     pthread_t *threads;
     int num_threads;
@@ -24,11 +41,13 @@ extern worker_pool_t *worker_pool;
 void worker_pool_destroy(worker_pool_t *pool);
 void* worker_thread(void *arg);
 worker_pool_t* worker_pool_init(int num_threads, void* (*process_func)(void*));
-http_response_t* process_rest_request(http_request_t *requets, redisContext *c);
-void crud_create(const http_request_t *request, http_response_t *response, redisContext *c );
-void crud_read(const http_request_t *request, http_response_t *response, redisContext *c );
-void crud_delete(const http_request_t *request, http_response_t *response, redisContext *c );
-void crud_update(const http_request_t *request, http_response_t *response, redisContext *c );
+http_response_t* process_rest_request(http_request_t *request, book_call_t *call);
+int async_process_request(struct reactor *reactor, client_request_node_t *node);
+void crud_create(const http_request_t *request, const route_params_t *params, http_response_t *response, void *context);
+void crud_read(const http_request_t *request, const route_params_t *params, http_response_t *response, void *context);
+void crud_delete(const http_request_t *request, const route_params_t *params, http_response_t *response, void *context);
+void crud_update(const http_request_t *request, const route_params_t *params, http_response_t *response, void *context);
+void server_stats(const http_request_t *request, const route_params_t *params, http_response_t *response, void *context);
 #endif
 
 /* 
@@ -3,55 +3,52 @@
 #include "http_utils.h"
 #include "requests_queue.h"
 #include "workers.h"
+#include "server_config.h"
+#include "book_cache.h"
+#include <signal.h>
 
 
 worker_pool_t *worker_pool;
 redis_pool_t *redis_pool;
 
-int main() {
-    const int SERVER_PORT = 8080;
-    const int MAX_EVENTS = 10;
+int main(int argc, char **argv) {
+    init_server_config(&server_config);
+    int config_result = parse_server_config(argc, argv, &server_config);
+    if (config_result != 0) {
+        return config_result > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    print_server_config(&server_config);
 
-    redis_pool =  malloc(sizeof(worker_pool_t));
+    redis_pool = malloc(sizeof(redis_pool_t));
+    if (!redis_pool || redis_pool_init(redis_pool, server_config.redis_pool_size, REDIS_HOST, REDIS_PORT) < 0) {
+        printf("Errore nell'inizializzazione del pool Redis\n");
+        return EXIT_FAILURE;
+    }
 
-    init_redis_pool(10,redis_pool);
+    if (book_cache_init(&book_cache, server_config.book_cache_size, server_config.book_cache_ttl) < 0) {
+        printf("Errore nell'inizializzazione della cache dei libri\n");
+        return EXIT_FAILURE;
+    }
 
     // Inizializza il server
-    int server_fd = initialize_server(SERVER_PORT);
-    if (server_fd < 0) {
+    if (initialize_server() < 0) {
         return EXIT_FAILURE;
     }
     
-    int epoll_fd = init_epoll_istance();
-    add_fd_to_epoll_istance(server_fd, epoll_fd, EPOLLIN);
-    
-    struct epoll_event events[MAX_EVENTS];
+    // Le scritture su un client già disconnesso ritornano EPIPE invece di terminare il processo
+    signal(SIGPIPE, SIG_IGN);
+
+    reactor_t *reactors = start_reactors(server_config.reactors, server_config.port);
+    if (!reactors) {
+        return EXIT_FAILURE;
+    }
     
     printf("Server pronto per accettare connessioni\n");
     
-    // Main event loop
-    while (1) {
-        int num_events = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
-        
-        if (num_events == -1) {
-            if (errno == EINTR) {
-                // Segnale ricevuto, continua
-                continue;
-            }
-            perror("epoll_wait failed");
-            break;
-        }
-        
-        if (num_events > 0) {
-            if (process_epoll_events(server_fd, epoll_fd, events, num_events) < 0) {
-                printf("Errore nel processare gli eventi\n");
-                // Potresti decidere se continuare o uscire
-            }
-        }
-    }
+    // Il thread principale esegue il primo reactor
+    reactor_run(&reactors[0]);
     
-    cleanup_resources(server_fd, epoll_fd);
+    cleanup_resources(reactors[0].listen_fd, reactors[0].epoll_fd);
     
     return EXIT_SUCCESS;
 }
-
@@ -1,6 +1,5 @@
 #include "book.h"
-
-extern redis_pool_t *redis_pool;
+#include "book_cache.h"
 
 // Connessione a Redis
 redisContext* connect_redis() {
@@ -17,149 +16,319 @@ redisContext* connect_redis() {
     return c;
 }
 
+// I comandi dei libri esistono in due forme: format_* li prepara nel
+// protocollo di Redis (da liberare con redisFreeCommand), così possono
+// essere accodati in pipeline dai worker o inviati dal client asincrono del
+// reactor, e *_reply interpreta la risposta corrispondente. Le funzioni
+// sincrone combinano le due cose.
+//
+// Gli argomenti passano come array con le loro lunghezze, mai attraverso
+// il parser di formato di hiredis: titoli e autori con spazi o byte
+// qualsiasi restano un solo argomento.
+
+// Campi dell'hash di un libro, nell'ordine in cui HMGET li restituisce:
+// la risposta si decodifica per posizione, senza confrontare i nomi
+enum {
+    BOOK_FIELD_ID,
+    BOOK_FIELD_TITLE,
+    BOOK_FIELD_AUTHOR,
+    BOOK_FIELD_PRICE,
+    BOOK_FIELD_COUNT
+};
+
+static const char *const book_fields[BOOK_FIELD_COUNT] = { "id", "title", "author", "price" };
+static const size_t book_field_lengths[BOOK_FIELD_COUNT] = { 2, 5, 6, 5 };
+
+#define BOOK_KEY_PREFIX "book:"
+#define BOOK_KEY_PREFIX_LENGTH 5
+#define BOOK_KEY_SIZE 24            // Prefisso, segno e 10 cifre
+#define BOOK_PRICE_SIZE 320         // "%.2f" del double più grande
+
+// Cifre decimali di value in out, senza terminatore; ritorna quante sono
+static size_t format_int(char *out, int value) {
+    char digits[12];
+    size_t i = sizeof(digits);
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+
+    do {
+        digits[--i] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (value < 0) {
+        digits[--i] = '-';
+    }
+
+    memcpy(out, digits + i, sizeof(digits) - i);
+    return sizeof(digits) - i;
+}
+
+// Chiave "book:<id>" nel buffer del chiamante; ritorna la lunghezza
+static size_t format_book_key(char *key, int book_id) {
+    memcpy(key, BOOK_KEY_PREFIX, BOOK_KEY_PREFIX_LENGTH);
+    size_t length = BOOK_KEY_PREFIX_LENGTH + format_int(key + BOOK_KEY_PREFIX_LENGTH, book_id);
+    key[length] = '\0';
+    return length;
+}
+
+// Comando su una sola chiave (DEL, EXISTS, ...)
+static int format_key_command(char **command, const char *name, int book_id) {
+    char key[BOOK_KEY_SIZE];
+    const char *argv[2] = { name, key };
+    size_t argvlen[2] = { strlen(name), format_book_key(key, book_id) };
+
+    return (int)redisFormatCommandArgv(command, 2, argv, argvlen);
+}
+
+// Invia il comando e ne attende la risposta; NULL se la connessione è caduta
+static redisReply* run_command(redisContext *c, char *command, int length) {
+    if (length < 0) {
+        return NULL;
+    }
+
+    int appended = redisAppendFormattedCommand(c, command, length);
+    redisFreeCommand(command);
+
+    void *reply = NULL;
+    if (appended != REDIS_OK || redisGetReply(c, &reply) != REDIS_OK) {
+        return NULL;
+    }
+    return reply;
+}
+
 // Salva un libro usando HSET
-int save_book(redisContext *c, const Book *book) {
-    redisReply *reply;
-    char key[64];
-    
-    // Crea la chiave del libro
-    snprintf(key, sizeof(key), "book:%d", book->id);
-    
-    // Usa HSET per salvare tutti i campi
-    reply = redisCommand(c, "HSET %s id %d title %s author %s price %.2f",
-                        key, book->id, book->title, book->author, book->price);
-    
-    if (reply == NULL) {
+int format_save_book(char **command, const Book *book) {
+    char key[BOOK_KEY_SIZE];
+    char id[BOOK_KEY_SIZE];
+    char price[BOOK_PRICE_SIZE];
+
+    const char *argv[2 + 2 * BOOK_FIELD_COUNT] = {
+        "HSET", key,
+        book_fields[BOOK_FIELD_ID], id,
+        book_fields[BOOK_FIELD_TITLE], book->title,
+        book_fields[BOOK_FIELD_AUTHOR], book->author,
+        book_fields[BOOK_FIELD_PRICE], price,
+    };
+    size_t argvlen[2 + 2 * BOOK_FIELD_COUNT] = {
+        4, format_book_key(key, book->id),
+        book_field_lengths[BOOK_FIELD_ID], format_int(id, book->id),
+        book_field_lengths[BOOK_FIELD_TITLE], strnlen(book->title, sizeof(book->title)),
+        book_field_lengths[BOOK_FIELD_AUTHOR], strnlen(book->author, sizeof(book->author)),
+        book_field_lengths[BOOK_FIELD_PRICE], snprintf(price, sizeof(price), "%.2f", book->price),
+    };
+
+    return (int)redisFormatCommandArgv(command, 2 + 2 * BOOK_FIELD_COUNT, argv, argvlen);
+}
+
+// Le *_reply delle scritture invalidano la cache dei libri anche se il
+// comando è fallito: senza risposta non si sa se Redis l'abbia applicato
+int save_book_reply(const Book *book, const redisReply *reply) {
+    book_cache_invalidate(&book_cache, book->id);
+
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
         printf("Errore nel comando HSET\n");
         return -1;
     }
-    
-    printf("Libro salvato: %s\n", key);
-    freeReplyObject(reply);
+
+    printf("Libro salvato: book:%d\n", book->id);
     return 0;
 }
 
-// Carica un libro usando HGETALL
-Book* load_book(redisContext *c, int book_id) {
-    redisReply *reply;
-    char key[64];
-    Book *book = NULL;
-    
-    snprintf(key, sizeof(key), "book:%d", book_id);
-    
-    // Recupera tutti i campi del libro
-    reply = redisCommand(c, "HGETALL %s", key);
-    
-    if (reply == NULL) {
-        printf("Errore nel comando HGETALL\n");
-        return NULL;
+int save_book(redisContext *c, const Book *book) {
+    char *command;
+    int length = format_save_book(&command, book);
+    redisReply *reply = run_command(c, command, length);
+    int result = save_book_reply(book, reply);
+    if (reply) {
+        freeReplyObject(reply);
+    }
+    return result;
+}
+
+// Carica un libro usando HMGET sui campi di book_fields
+int format_load_book(char **command, int book_id) {
+    char key[BOOK_KEY_SIZE];
+    const char *argv[2 + BOOK_FIELD_COUNT] = { "HMGET", key };
+    size_t argvlen[2 + BOOK_FIELD_COUNT] = { 5, format_book_key(key, book_id) };
+
+    for (int i = 0; i < BOOK_FIELD_COUNT; i++) {
+        argv[2 + i] = book_fields[i];
+        argvlen[2 + i] = book_field_lengths[i];
+    }
+
+    return (int)redisFormatCommandArgv(command, 2 + BOOK_FIELD_COUNT, argv, argvlen);
+}
+
+// Copia una stringa della risposta troncandola a size - 1 byte
+static void copy_reply_string(char *out, size_t size, const redisReply *value) {
+    size_t length = value->len < size - 1 ? value->len : size - 1;
+    memcpy(out, value->str, length);
+    out[length] = '\0';
+}
+
+// Riempie book dai valori di HMGET: 1 se il libro esiste, 0 se non c'è,
+// -1 se il comando è fallito. Un campo assente resta a zero
+int load_book_reply(const redisReply *reply, Book *book) {
+    if (reply == NULL || reply->type != REDIS_REPLY_ARRAY || reply->elements != BOOK_FIELD_COUNT) {
+        printf("Errore nel comando HMGET\n");
+        return -1;
     }
-    
-    if (reply->type == REDIS_REPLY_ARRAY && reply->elements > 0) {
-        book = malloc(sizeof(Book));
-        if (book == NULL) {
-            printf("Errore allocazione memoria\n");
-            freeReplyObject(reply);
-            return NULL;
+
+    memset(book, 0, sizeof(Book));
+
+    int found = 0;
+    for (int i = 0; i < BOOK_FIELD_COUNT; i++) {
+        const redisReply *value = reply->element[i];
+        if (value->type != REDIS_REPLY_STRING) {
+            continue;
         }
-        
-        // Parsing della risposta (field1, value1, field2, value2, ...)
-        for (size_t i = 0; i < reply->elements; i += 2) {
-            char *field = reply->element[i]->str;
-            char *value = reply->element[i + 1]->str;
-            
-            if (strcmp(field, "id") == 0) {
-                book->id = atoi(value);
-            } else if (strcmp(field, "title") == 0) {
-                strncpy(book->title, value, sizeof(book->title) - 1);
-                book->title[sizeof(book->title) - 1] = '\0';
-            } else if (strcmp(field, "author") == 0) {
-                strncpy(book->author, value, sizeof(book->author) - 1);
-                book->author[sizeof(book->author) - 1] = '\0';
-            } else if (strcmp(field, "price") == 0) {
-                book->price = atof(value);
-            }
+        found = 1;
+
+        switch (i) {
+            case BOOK_FIELD_ID:
+                book->id = atoi(value->str);
+                break;
+            case BOOK_FIELD_TITLE:
+                copy_reply_string(book->title, sizeof(book->title), value);
+                break;
+            case BOOK_FIELD_AUTHOR:
+                copy_reply_string(book->author, sizeof(book->author), value);
+                break;
+            case BOOK_FIELD_PRICE:
+                book->price = atof(value->str);
+                break;
         }
     }
-    
-    freeReplyObject(reply);
+
+    return found;
+}
+
+// Passa da Redis solo se il libro non è nella cache
+Book* load_book(redisContext *c, int book_id) {
+    Book *book = malloc(sizeof(Book));
+    if (book == NULL) {
+        printf("Errore allocazione memoria\n");
+        return NULL;
+    }
+
+    uint64_t version;
+    if (book_cache_get(&book_cache, book_id, book, &version)) {
+        return book;
+    }
+
+    char *command;
+    int length = format_load_book(&command, book_id);
+    redisReply *reply = run_command(c, command, length);
+
+    if (load_book_reply(reply, book) == 1) {
+        book_cache_fill(&book_cache, book, version);
+    } else {
+        free(book);
+        book = NULL;
+    }
+
+    if (reply) {
+        freeReplyObject(reply);
+    }
     return book;
 }
 
 // Aggiorna il prezzo di un libro usando HSET
-int update_book_price(redisContext *c, int book_id, double new_price) {
-    redisReply *reply;
-    char key[64];
-    
-    snprintf(key, sizeof(key), "book:%d", book_id);
-    
-    reply = redisCommand(c, "HSET %s price %.2f", key, new_price);
-    
-    if (reply == NULL) {
+int format_update_book_price(char **command, int book_id, double new_price) {
+    char key[BOOK_KEY_SIZE];
+    char price[BOOK_PRICE_SIZE];
+    const char *argv[4] = { "HSET", key, book_fields[BOOK_FIELD_PRICE], price };
+    size_t argvlen[4] = {
+        4, format_book_key(key, book_id),
+        book_field_lengths[BOOK_FIELD_PRICE], snprintf(price, sizeof(price), "%.2f", new_price),
+    };
+
+    return (int)redisFormatCommandArgv(command, 4, argv, argvlen);
+}
+
+int update_book_price_reply(int book_id, double new_price, const redisReply *reply) {
+    book_cache_invalidate(&book_cache, book_id);
+
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
         printf("Errore aggiornamento prezzo\n");
         return -1;
     }
-    
-    printf("Prezzo aggiornato per %s: %.2f\n", key, new_price);
-    freeReplyObject(reply);
+
+    printf("Prezzo aggiornato per book:%d: %.2f\n", book_id, new_price);
     return 0;
 }
 
+int update_book_price(redisContext *c, int book_id, double new_price) {
+    char *command;
+    int length = format_update_book_price(&command, book_id, new_price);
+    redisReply *reply = run_command(c, command, length);
+    int result = update_book_price_reply(book_id, new_price, reply);
+    if (reply) {
+        freeReplyObject(reply);
+    }
+    return result;
+}
+
 // Verifica se un libro esiste
 int book_exists(redisContext *c, int book_id) {
-    redisReply *reply;
-    char key[64];
+    char *command;
+    int length = format_key_command(&command, "EXISTS", book_id);
+    redisReply *reply = run_command(c, command, length);
     int exists = 0;
-    
-    snprintf(key, sizeof(key), "book:%d", book_id);
-    
-    reply = redisCommand(c, "EXISTS %s", key);
-    
+
     if (reply != NULL) {
-        exists = reply->integer;
+        exists = reply->type == REDIS_REPLY_INTEGER && reply->integer;
         freeReplyObject(reply);
     }
-    
+
     return exists;
 }
 
 // Elimina un libro
-int delete_book(redisContext *c, int book_id) {
-    redisReply *reply;
-    char key[64];
-    
-    snprintf(key, sizeof(key), "book:%d", book_id);
-    
-    reply = redisCommand(c, "DEL %s", key);
-    
-    if (reply == NULL) {
+int format_delete_book(char **command, int book_id) {
+    return format_key_command(command, "DEL", book_id);
+}
+
+int delete_book_reply(int book_id, const redisReply *reply) {
+    book_cache_invalidate(&book_cache, book_id);
+
+    if (reply == NULL || reply->type == REDIS_REPLY_ERROR) {
         printf("Errore eliminazione libro\n");
         return -1;
     }
-    
-    printf("Libro eliminato: %s\n", key);
-    freeReplyObject(reply);
+
+    printf("Libro eliminato: book:%d\n", book_id);
     return 0;
 }
 
+int delete_book(redisContext *c, int book_id) {
+    char *command;
+    int length = format_delete_book(&command, book_id);
+    redisReply *reply = run_command(c, command, length);
+    int result = delete_book_reply(book_id, reply);
+    if (reply) {
+        freeReplyObject(reply);
+    }
+    return result;
+}
+
 // Ottieni un singolo campo usando HGET
 char* get_book_field(redisContext *c, int book_id, const char *field) {
-    redisReply *reply;
-    char key[64];
+    char key[BOOK_KEY_SIZE];
+    const char *argv[3] = { "HGET", key, field };
+    size_t argvlen[3] = { 4, format_book_key(key, book_id), strlen(field) };
     char *value = NULL;
-    
-    snprintf(key, sizeof(key), "book:%d", book_id);
-    
-    reply = redisCommand(c, "HGET %s %s", key, field);
-    
+
+    redisReply *reply = redisCommandArgv(c, 3, argv, argvlen);
+
     if (reply != NULL && reply->type == REDIS_REPLY_STRING) {
-        value = strdup(reply->str);  // Copia la stringa
+        value = strndup(reply->str, reply->len);  // Copia la stringa
     }
-    
+
     if (reply) {
         freeReplyObject(reply);
     }
-    
+
     return value;  // Ricorda di fare free() del risultato
 }
 
@@ -173,139 +342,3 @@ void print_book(const Book *book) {
         printf("---\n");
     }
 }
-
-// Inizializzazione del pool Redis
-int init_redis_pool(int pool_size,redis_pool_t * redis_pool) {
-    redis_pool->connections = malloc(sizeof(redisContext*) * pool_size);
-    redis_pool->size = pool_size;
-    redis_pool->current = 0;
-    
-    if (pthread_mutex_init(&redis_pool->mutex, NULL) != 0) {
-        fprintf(stderr, "Errore nell'inizializzazione del mutex Redis\n");
-        return -1;
-    }
-    
-    for (int i = 0; i < pool_size; i++) {
-        redis_pool->connections[i] = redisConnect(REDIS_HOST, REDIS_PORT);
-        if (redis_pool->connections[i] == NULL || redis_pool->connections[i]->err) {
-            if (redis_pool->connections[i]) {
-                fprintf(stderr, "Errore connessione Redis: %s\n", 
-                        redis_pool->connections[i]->errstr);
-                redisFree(redis_pool->connections[i]);
-            } else {
-                fprintf(stderr, "Impossibile allocare il contesto Redis\n");
-            }
-            return -1;
-        }
-    }
-    
-    printf("Pool Redis inizializzato con %d connessioni\n", pool_size);
-    return 0;
-}
-
-redisContext* get_redis_connection() {
-// Ottenimento di una connessione Redis dal pool
-    pthread_mutex_lock(&redis_pool->mutex);
-    redisContext *ctx = redis_pool->connections[redis_pool->current];
-    redis_pool->current = (redis_pool->current + 1) % redis_pool->size;
-    pthread_mutex_unlock(&redis_pool->mutex);
-    return ctx;
-}
-
-
-
-int parse_book_json(const char* json_string, Book* book) {
-    if (!json_string || !book) return 0;
-    
-    // Crea una copia della stringa per manipolarla
-    char* json_copy = strdup(json_string);
-    if (!json_copy) return 0;
-    // Estrai id_book
-    double id_value = extract_numeric_value(json_copy, "id_book");
-    book->id = (int)id_value;
-        printf("Here\n");
-
-    // Estrai title
-    char* title_value = extract_string_value(json_copy, "title");
-    if (title_value) {
-        strncpy(book->title, title_value, sizeof(book->title) - 1);
-        book->title[sizeof(book->title) - 1] = '\0';
-        free(title_value);
-    } else {
-        book->title[0] = '\0';
-    }
-    
-    // Estrai author
-    char* author_value = extract_string_value(json_copy, "author");
-    if (author_value) {
-        strncpy(book->author, author_value, sizeof(book->author) - 1);
-        book->author[sizeof(book->author) - 1] = '\0';
-        free(author_value);
-    } else {
-        book->author[0] = '\0';
-    }
-    
-    // Estrai price
-    book->price = extract_numeric_value(json_copy, "price");
-    
-    free(json_copy);
-    return 1; // Successo
-}
-
-
-char* book_trim_whitespace(char* str) {
-    while (isspace(*str)) str++;
-    return str;
-}
-
-// Funzione per estrarre il valore tra virgolette
-char* extract_string_value(char* json, const char* key) {
-    char search_pattern[512];
-    snprintf(search_pattern, sizeof(search_pattern), "\"%s\"", key);
-    
-    char* key_pos = strstr(json, search_pattern);
-    if (!key_pos) return NULL;
-    
-    // Trova i due punti dopo la chiave
-    char* colon = strchr(key_pos, ':');
-    if (!colon) return NULL;
-    
-    // Salta spazi dopo i due punti
-    colon++;
-    colon = book_trim_whitespace(colon);
-    
-    // Deve iniziare con virgolette per essere una stringa
-    if (*colon != '"') return NULL;
-    colon++; // Salta la prima virgoletta
-    
-    // Trova la virgoletta di chiusura
-    char* end_quote = strchr(colon, '"');
-    if (!end_quote) return NULL;
-    
-    // Alloca memoria per il risultato
-    int len = end_quote - colon;
-    char* result = malloc(len + 1);
-    strncpy(result, colon, len);
-    result[len] = '\0';
-    
-    return result;
-}
-
-// Funzione per estrarre un valore numerico
-double extract_numeric_value(char* json, const char* key) {
-    char search_pattern[512];
-    snprintf(search_pattern, sizeof(search_pattern), "\"%s\"", key);
-    
-    char* key_pos = strstr(json, search_pattern);
-    if (!key_pos) return 0;
-    
-    // Trova i due punti dopo la chiave
-    char* colon = strchr(key_pos, ':');
-    if (!colon) return 0;
-    
-    // Salta spazi dopo i due punti
-    colon++;
-    colon = book_trim_whitespace(colon);
-    
-    return atof(colon);
-}
\ No newline at end of file
@@ -0,0 +1,264 @@
+// book_cache.c
+//
+// Cache LRU dei libri davanti a Redis, divisa in shard con un mutex
+// ciascuno: richieste su libri diversi raramente si contendono lo stesso
+// lock. Le scritture invalidano la voce dopo che Redis le ha applicate e
+// fanno scartare le letture concorrenti, così un'istanza non serve mai un
+// libro più vecchio dell'ultima scrittura che ha completato.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "book_cache.h"
+
+book_cache_t book_cache;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Hash di Fibonacci dell'id: i bit alti scelgono lo shard, i bassi il bucket
+static uint32_t hash_id(int book_id) {
+    return (uint32_t)book_id * 2654435761u;
+}
+
+static book_cache_shard_t* shard_for(book_cache_t *cache, uint32_t hash) {
+    return &cache->shards[hash >> (32 - BOOK_CACHE_SHARD_BITS)];
+}
+
+static void lru_unlink(book_cache_shard_t *shard, book_cache_entry_t *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        shard->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        shard->lru_tail = entry->lru_prev;
+    }
+}
+
+static void lru_push_front(book_cache_shard_t *shard, book_cache_entry_t *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head) {
+        shard->lru_head->lru_prev = entry;
+    } else {
+        shard->lru_tail = entry;
+    }
+    shard->lru_head = entry;
+}
+
+// Puntatore al collegamento che porta alla voce con questo id (o al NULL
+// finale della catena), per poterla staccare senza un secondo giro
+static book_cache_entry_t** find_link(book_cache_shard_t *shard, uint32_t hash, int book_id) {
+    book_cache_entry_t **link = &shard->buckets[hash & shard->bucket_mask];
+    while (*link && (*link)->book.id != book_id) {
+        link = &(*link)->hash_next;
+    }
+    return link;
+}
+
+// Stacca la voce puntata da link e la rimette tra le libere
+static void remove_entry(book_cache_shard_t *shard, book_cache_entry_t **link) {
+    book_cache_entry_t *entry = *link;
+
+    *link = entry->hash_next;
+    lru_unlink(shard, entry);
+    entry->hash_next = shard->free_list;
+    shard->free_list = entry;
+    shard->count--;
+}
+
+// Dimensiona la cache su max_bytes, contando voci e bucket; 0 la disabilita
+int book_cache_init(book_cache_t *cache, size_t max_bytes, int ttl_seconds) {
+    memset(cache, 0, sizeof(book_cache_t));
+
+    size_t per_entry = sizeof(book_cache_entry_t) + sizeof(book_cache_entry_t *);
+    size_t capacity = max_bytes / per_entry / BOOK_CACHE_SHARDS;
+    if (capacity == 0) {
+        return 0;
+    }
+    if (capacity > INT32_MAX / 2) {
+        capacity = INT32_MAX / 2;
+    }
+
+    // Bucket in potenza di 2, non più delle voci: catene lunghe in media ~1
+    uint32_t buckets = 1;
+    while (buckets * 2 <= capacity) {
+        buckets *= 2;
+    }
+
+    for (int i = 0; i < BOOK_CACHE_SHARDS; i++) {
+        book_cache_shard_t *shard = &cache->shards[i];
+
+        shard->entries = calloc(capacity, sizeof(book_cache_entry_t));
+        shard->buckets = calloc(buckets, sizeof(book_cache_entry_t *));
+        if (!shard->entries || !shard->buckets || pthread_mutex_init(&shard->mutex, NULL) != 0) {
+            free(shard->entries);
+            free(shard->buckets);
+            shard->entries = NULL;
+            shard->buckets = NULL;
+            for (int j = 0; j < i; j++) {
+                pthread_mutex_destroy(&cache->shards[j].mutex);
+                free(cache->shards[j].entries);
+                free(cache->shards[j].buckets);
+            }
+            memset(cache, 0, sizeof(book_cache_t));
+            return -1;
+        }
+
+        shard->bucket_mask = buckets - 1;
+        shard->capacity = (int)capacity;
+        for (size_t j = 0; j < capacity; j++) {
+            shard->entries[j].hash_next = shard->free_list;
+            shard->free_list = &shard->entries[j];
+        }
+    }
+
+    cache->ttl_ms = (uint64_t)ttl_seconds * 1000;
+    cache->enabled = true;
+    return 0;
+}
+
+void book_cache_destroy(book_cache_t *cache) {
+    if (!cache->enabled) {
+        return;
+    }
+
+    for (int i = 0; i < BOOK_CACHE_SHARDS; i++) {
+        pthread_mutex_destroy(&cache->shards[i].mutex);
+        free(cache->shards[i].entries);
+        free(cache->shards[i].buckets);
+    }
+    memset(cache, 0, sizeof(book_cache_t));
+}
+
+// Copia il libro in book se è in cache e non è scaduto. In caso di miss
+// version riceve la versione dello shard, da ripassare a book_cache_fill
+// con il libro letto da Redis
+bool book_cache_get(book_cache_t *cache, int book_id, Book *book, uint64_t *version) {
+    *version = 0;
+    if (!cache->enabled) {
+        return false;
+    }
+
+    uint32_t hash = hash_id(book_id);
+    book_cache_shard_t *shard = shard_for(cache, hash);
+    bool hit = false;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    book_cache_entry_t **link = find_link(shard, hash, book_id);
+    book_cache_entry_t *entry = *link;
+    if (entry && entry->expires_ms <= now_ms()) {
+        remove_entry(shard, link);
+        shard->expirations++;
+        entry = NULL;
+    }
+
+    if (entry) {
+        *book = entry->book;
+        lru_unlink(shard, entry);
+        lru_push_front(shard, entry);
+        shard->hits++;
+        hit = true;
+    } else {
+        *version = shard->version;
+        shard->misses++;
+    }
+
+    pthread_mutex_unlock(&shard->mutex);
+    return hit;
+}
+
+// Inserisce (o aggiorna) il libro letto da Redis, a meno che nel frattempo
+// una scrittura abbia invalidato lo shard. A cache piena esce la voce usata
+// meno di recente
+void book_cache_fill(book_cache_t *cache, const Book *book, uint64_t version) {
+    if (!cache->enabled) {
+        return;
+    }
+
+    uint32_t hash = hash_id(book->id);
+    book_cache_shard_t *shard = shard_for(cache, hash);
+
+    pthread_mutex_lock(&shard->mutex);
+
+    if (shard->version != version) {
+        pthread_mutex_unlock(&shard->mutex);
+        return;
+    }
+
+    book_cache_entry_t **link = find_link(shard, hash, book->id);
+    book_cache_entry_t *entry = *link;
+
+    if (entry) {
+        lru_unlink(shard, entry);
+    } else {
+        if (!shard->free_list) {
+            book_cache_entry_t *victim = shard->lru_tail;
+            remove_entry(shard, find_link(shard, hash_id(victim->book.id), victim->book.id));
+            shard->evictions++;
+        }
+
+        entry = shard->free_list;
+        shard->free_list = entry->hash_next;
+
+        // find_link va ripetuta: l'eviction può aver cambiato la catena
+        link = find_link(shard, hash, book->id);
+        entry->hash_next = NULL;
+        *link = entry;
+        shard->count++;
+    }
+
+    entry->book = *book;
+    entry->expires_ms = now_ms() + cache->ttl_ms;
+    lru_push_front(shard, entry);
+
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+// Da chiamare dopo ogni scrittura del libro su Redis, riuscita o no: se la
+// risposta manca la scrittura potrebbe essere stata comunque applicata
+void book_cache_invalidate(book_cache_t *cache, int book_id) {
+    if (!cache->enabled) {
+        return;
+    }
+
+    uint32_t hash = hash_id(book_id);
+    book_cache_shard_t *shard = shard_for(cache, hash);
+
+    pthread_mutex_lock(&shard->mutex);
+
+    book_cache_entry_t **link = find_link(shard, hash, book_id);
+    if (*link) {
+        remove_entry(shard, link);
+    }
+    shard->version++;
+
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+void book_cache_stats(book_cache_t *cache, book_cache_stats_t *stats) {
+    memset(stats, 0, sizeof(book_cache_stats_t));
+    if (!cache->enabled) {
+        return;
+    }
+
+    for (int i = 0; i < BOOK_CACHE_SHARDS; i++) {
+        book_cache_shard_t *shard = &cache->shards[i];
+
+        pthread_mutex_lock(&shard->mutex);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->expirations += shard->expirations;
+        stats->entries += shard->count;
+        stats->capacity += shard->capacity;
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
@@ -0,0 +1,202 @@
+// book_codec.c
+//
+// Conversione dei libri da e verso i formati dei body HTTP: JSON e
+// MessagePack. Nessuna dipendenza da Redis, così anche i benchmark possono usarlo.
+
+#include <limits.h>
+#include <math.h>
+#include "book.h"
+#include "json_reader.h"
+#include "msgpack.h"
+
+#define BOOK_ID_ERROR "id_book deve essere un intero non negativo"
+
+// Chiave nota di un libro (JSON o MessagePack)
+static bool key_is(const char *key, size_t length, const char *name) {
+    return length == strlen(name) && memcmp(key, name, length) == 0;
+}
+
+// Controllato prima della conversione: un double fuori intervallo non si
+// può convertire a int
+static bool valid_book_id(double number) {
+    return number >= 0 && number <= INT_MAX && number == floor(number);
+}
+
+// Legge un Book da un oggetto JSON in un solo passaggio: le stringhe vengono
+// decodificate (escape compresi) direttamente nei campi, le chiavi
+// sconosciute saltate. Nessuna allocazione. Ritorna 1 se il JSON è valido;
+// altrimenti 0 e, se error non è NULL, posizione e motivo del primo errore.
+int parse_book_json(const char *json, size_t length, Book *book, book_parse_error_t *error) {
+    if (!json || !book) return 0;
+
+    json_reader_t reader;
+    json_reader_init(&reader, json, length);
+
+    memset(book, 0, sizeof(Book));
+
+    bool first = true;
+    if (json_expect(&reader, '{')) {
+        while (json_object_next(&reader, &first)) {
+            char key[16];
+            size_t key_length;
+            double number;
+
+            if (!json_read_key(&reader, key, sizeof(key), &key_length)) {
+                break;
+            }
+
+            if (key_is(key, key_length, "id_book")) {
+                if (json_read_number(&reader, &number)) {
+                    if (valid_book_id(number)) {
+                        book->id = (int)number;
+                    } else {
+                        json_reader_fail(&reader, BOOK_ID_ERROR);
+                    }
+                }
+            } else if (key_is(key, key_length, "title")) {
+                json_read_string(&reader, book->title, sizeof(book->title), NULL);
+            } else if (key_is(key, key_length, "author")) {
+                json_read_string(&reader, book->author, sizeof(book->author), NULL);
+            } else if (key_is(key, key_length, "price")) {
+                if (json_read_number(&reader, &number)) {
+                    book->price = number;
+                }
+            } else {
+                json_skip_value(&reader);
+            }
+
+            if (reader.error) {
+                break;
+            }
+        }
+        json_expect_end(&reader);
+    }
+
+    if (reader.error) {
+        if (error) {
+            error->position = reader.error_position;
+            error->message = reader.error;
+        }
+        return 0;
+    }
+
+    return 1;
+}
+
+// Serializza un libro come oggetto JSON compatto nel writer
+void write_book_json(json_writer_t *writer, const Book *book) {
+    json_begin_object(writer);
+    json_key(writer, "id_book");
+    json_int(writer, book->id);
+    json_key(writer, "title");
+    json_cstring(writer, book->title);
+    json_key(writer, "author");
+    json_cstring(writer, book->author);
+    json_key(writer, "price");
+    json_double(writer, book->price);
+    json_end_object(writer);
+}
+
+// Array JSON di count libri
+void write_books_json(json_writer_t *writer, const Book *books, size_t count) {
+    json_begin_array(writer);
+    for (size_t i = 0; i < count; i++) {
+        write_book_json(writer, &books[i]);
+    }
+    json_end_array(writer);
+}
+
+// Stringa MessagePack copiata (con terminatore) in un campo di dimensione fissa
+static void read_msgpack_field(msgpack_reader_t *reader, char *out, size_t size) {
+    const unsigned char *value = reader->p;
+    const char *data;
+    uint32_t length;
+
+    if (!msgpack_read_str(reader, &data, &length)) {
+        return;
+    }
+    if (length >= size) {
+        reader->p = value;
+        msgpack_reader_fail(reader, "stringa troppo lunga");
+        return;
+    }
+
+    memcpy(out, data, length);
+    out[length] = '\0';
+}
+
+// Come parse_book_json per una mappa MessagePack: le chiavi vengono confrontate
+// direttamente nel buffer ricevuto, i valori copiati solo nei campi del Book
+int parse_book_msgpack(const char *data, size_t length, Book *book, book_parse_error_t *error) {
+    if (!data || !book) return 0;
+
+    msgpack_reader_t reader;
+    msgpack_reader_init(&reader, data, length);
+
+    memset(book, 0, sizeof(Book));
+
+    uint32_t count;
+    if (msgpack_read_map(&reader, &count)) {
+        for (uint32_t i = 0; i < count && !reader.error; i++) {
+            const char *key;
+            uint32_t key_length;
+            double number;
+
+            if (!msgpack_read_str(&reader, &key, &key_length)) {
+                break;
+            }
+
+            if (key_is(key, key_length, "id_book")) {
+                if (msgpack_read_number(&reader, &number)) {
+                    if (valid_book_id(number)) {
+                        book->id = (int)number;
+                    } else {
+                        msgpack_reader_fail(&reader, BOOK_ID_ERROR);
+                    }
+                }
+            } else if (key_is(key, key_length, "title")) {
+                read_msgpack_field(&reader, book->title, sizeof(book->title));
+            } else if (key_is(key, key_length, "author")) {
+                read_msgpack_field(&reader, book->author, sizeof(book->author));
+            } else if (key_is(key, key_length, "price")) {
+                if (msgpack_read_number(&reader, &number)) {
+                    book->price = number;
+                }
+            } else {
+                msgpack_skip_value(&reader);
+            }
+        }
+        msgpack_expect_end(&reader);
+    }
+
+    if (reader.error) {
+        if (error) {
+            error->position = reader.error_position;
+            error->message = reader.error;
+        }
+        return 0;
+    }
+
+    return 1;
+}
+
+// Serializza un libro come mappa MessagePack con le stesse chiavi del JSON
+void write_book_msgpack(msgpack_writer_t *writer, const Book *book) {
+    msgpack_write_map(writer, 4);
+    msgpack_write_str(writer, "id_book", 7);
+    msgpack_write_int(writer, book->id);
+    msgpack_write_str(writer, "title", 5);
+    msgpack_write_cstr(writer, book->title);
+    msgpack_write_str(writer, "author", 6);
+    msgpack_write_cstr(writer, book->author);
+    msgpack_write_str(writer, "price", 5);
+    msgpack_write_double(writer, book->price);
+}
+
+// Array MessagePack di count libri
+void write_books_msgpack(msgpack_writer_t *writer, const Book *books, size_t count) {
+    msgpack_write_array(writer, (uint32_t)count);
+    for (size_t i = 0; i < count; i++) {
+        write_book_msgpack(writer, &books[i]);
+    }
+}
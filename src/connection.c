@@ -0,0 +1,234 @@
+// connection.c
+
+#include <errno.h>
+#include <sys/uio.h>
+#include "connection.h"
+#include "requests_queue.h"
+
+// Tabella delle connessioni indicizzata per fd
+static connection_t **connection_table = NULL;
+static int connection_table_size = 0;
+
+// Limite del buffer di ricezione: header, body massimo e una lettura in più
+static size_t connection_max_input = 0;
+
+int init_connection_table(int max_fds, size_t max_body_size) {
+    connection_table = calloc(max_fds, sizeof(connection_t *));
+    if (!connection_table) {
+        printf("Errore: impossibile allocare la tabella delle connessioni\n");
+        return -1;
+    }
+
+    connection_table_size = max_fds;
+    connection_max_input = HTTP_MAX_HEADER_SECTION + max_body_size + CONNECTION_READ_CHUNK;
+    return 0;
+}
+
+connection_t* connection_open(int fd, struct reactor *reactor) {
+    if (fd < 0 || fd >= connection_table_size) {
+        printf("Errore: fd %d fuori dalla tabella delle connessioni\n", fd);
+        return NULL;
+    }
+
+    connection_t *conn = calloc(1, sizeof(connection_t));
+    if (!conn) {
+        return NULL;
+    }
+
+    conn->fd = fd;
+    conn->reactor = reactor;
+    conn->requests_served = 0;
+    timer_entry_init(&conn->timer, conn);
+
+    connection_table[fd] = conn;
+    return conn;
+}
+
+connection_t* connection_get(int fd) {
+    if (fd < 0 || fd >= connection_table_size) {
+        return NULL;
+    }
+
+    return connection_table[fd];
+}
+
+// Libera lo stato e chiude il socket. Lo slot viene liberato prima della
+// close() così un accept() concorrente che riusa lo stesso fd trova lo slot vuoto.
+void connection_close(connection_t *conn) {
+    if (!conn) return;
+
+    int fd = conn->fd;
+    connection_release(conn);
+    close(fd);
+}
+
+// Libera lo stato senza chiudere il fd, per quando la close è già stata
+// eseguita altrove (backend io_uring). Nel frattempo il fd può essere stato
+// riassegnato a una nuova connessione: lo slot si libera solo se è ancora suo.
+void connection_release(connection_t *conn) {
+    if (!conn) return;
+
+    if (connection_table[conn->fd] == conn) {
+        connection_table[conn->fd] = NULL;
+    }
+
+    timer_wheel_cancel(&conn->timer);
+
+    output_entry_t *entry = conn->out_head;
+    while (entry) {
+        output_entry_t *next = entry->next;
+        free_http_response(entry->response);
+        free(entry);
+        entry = next;
+    }
+
+    free_http_response(conn->completed_response);
+    free_request_node(conn->request_node);
+    free(conn->in_buf);
+    free(conn);
+}
+
+// Garantisce almeno needed byte liberi in coda al buffer di ricezione
+int connection_reserve_input(connection_t *conn, size_t needed) {
+    if (conn->in_cap - conn->in_len >= needed) {
+        return 0;
+    }
+
+    if (conn->in_len + needed > connection_max_input) {
+        printf("Errore: richiesta troppo grande sul fd %d\n", conn->fd);
+        return -1;
+    }
+
+    size_t new_cap = conn->in_cap ? conn->in_cap * 2 : CONNECTION_READ_CHUNK;
+    if (new_cap < conn->in_len + needed) {
+        new_cap = conn->in_len + needed;
+    }
+    if (new_cap > connection_max_input) {
+        new_cap = connection_max_input;
+    }
+
+    char *new_buf = realloc(conn->in_buf, new_cap);
+    if (!new_buf) {
+        return -1;
+    }
+
+    conn->in_buf = new_buf;
+    conn->in_cap = new_cap;
+    return 0;
+}
+
+// Cede il buffer di ricezione alla richiesta completa che ne occupa i primi
+// length byte, senza copiarla: al posto del byte length viene scritto '\0'.
+// Solo gli eventuali byte in pipeline passano in un nuovo buffer; la capacità
+// in eccesso (es. riservata per un body) viene restituita all'allocatore.
+char* connection_detach_input(connection_t *conn, size_t length) {
+    size_t remaining = conn->in_len > length ? conn->in_len - length : 0;
+    char *rest = NULL;
+    size_t rest_cap = 0;
+
+    if (remaining > 0) {
+        rest_cap = remaining > CONNECTION_READ_CHUNK ? remaining : CONNECTION_READ_CHUNK;
+        rest = malloc(rest_cap);
+        if (!rest) {
+            return NULL;
+        }
+        memcpy(rest, conn->in_buf + length, remaining);
+    }
+
+    char *buffer = conn->in_buf;
+    if (conn->in_cap < length + 1 || conn->in_cap - length > CONNECTION_READ_CHUNK) {
+        char *resized = realloc(buffer, length + 1);
+        if (!resized && conn->in_cap < length + 1) {
+            free(rest);
+            return NULL;
+        }
+        if (resized) {
+            buffer = resized;
+        }
+    }
+    buffer[length] = '\0';
+
+    conn->in_buf = rest;
+    conn->in_len = remaining;
+    conn->in_cap = rest_cap;
+    return buffer;
+}
+
+// Accoda una risposta già costruita (build_response); la connessione ne
+// diventa proprietaria e la libera dopo l'invio
+int connection_queue_output(connection_t *conn, http_response_t *response) {
+    output_entry_t *entry = malloc(sizeof(output_entry_t));
+    if (!entry) {
+        return -1;
+    }
+
+    entry->response = response;
+    entry->offset = 0;
+    entry->next = NULL;
+
+    if (conn->out_tail) {
+        conn->out_tail->next = entry;
+    } else {
+        conn->out_head = entry;
+    }
+    conn->out_tail = entry;
+
+    return 0;
+}
+
+// Scrive quanto possibile della coda di output con writev. Ritorna
+// CONNECTION_FLUSH_DONE se la coda è vuota, CONNECTION_FLUSH_AGAIN se il
+// buffer del kernel è pieno (serve attendere EPOLLOUT), -1 in caso di errore.
+int connection_flush_output(connection_t *conn) {
+    while (conn->out_head) {
+        struct iovec iov[CONNECTION_MAX_IOV];
+        int iov_count = 0;
+
+        // Le parti di ogni risposta (status line, headers, body) e le
+        // risposte in pipeline escono con una sola writev
+        for (output_entry_t *entry = conn->out_head; entry && iov_count < CONNECTION_MAX_IOV; entry = entry->next) {
+            iov_count += http_response_iov(entry->response, entry->offset, iov + iov_count,
+                                           CONNECTION_MAX_IOV - iov_count);
+        }
+
+        ssize_t written = writev(conn->fd, iov, iov_count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return CONNECTION_FLUSH_AGAIN;
+            }
+            perror("writev failed");
+            return -1;
+        }
+
+        connection_output_sent(conn, (size_t)written);
+    }
+
+    return CONNECTION_FLUSH_DONE;
+}
+
+// Avanza la coda di output di written byte e libera le risposte inviate completamente
+void connection_output_sent(connection_t *conn, size_t written) {
+    size_t remaining = written;
+
+    while (conn->out_head && remaining > 0) {
+        output_entry_t *entry = conn->out_head;
+        size_t pending = entry->response->response_size - entry->offset;
+
+        if (remaining < pending) {
+            entry->offset += remaining;
+            break;
+        }
+
+        remaining -= pending;
+        conn->out_head = entry->next;
+        free_http_response(entry->response);
+        free(entry);
+    }
+
+    if (!conn->out_head) {
+        conn->out_tail = NULL;
+    }
+}
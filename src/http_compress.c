@@ -0,0 +1,110 @@
+// http_compress.c
+//
+// Compressione gzip/deflate del body delle risposte, negoziata con
+// l'header Accept-Encoding della richiesta (RFC 9110, 12.5.3).
+
+#include "http_compress.h"
+
+void http_compressor_init(http_compressor_t *compressor, int level, size_t min_size) {
+    memset(compressor, 0, sizeof(http_compressor_t));
+    compressor->level = level;
+    compressor->min_size = min_size;
+}
+
+void http_compressor_destroy(http_compressor_t *compressor) {
+    if (compressor->gzip_ready) {
+        deflateEnd(&compressor->gzip);
+    }
+    if (compressor->deflate_ready) {
+        deflateEnd(&compressor->deflate);
+    }
+    free(compressor->buffer);
+    memset(compressor, 0, sizeof(http_compressor_t));
+}
+
+// Peso (q in millesimi) che Accept-Encoding dà a coding; -1 se non compare
+// né direttamente né tramite "*"
+static int coding_quality(const char *header, const char *coding) {
+    int quality = http_header_quality(header, coding);
+    return quality >= 0 ? quality : http_header_quality(header, "*");
+}
+
+// Stream zlib per il formato richiesto: creato al primo uso, poi riusato
+static z_stream* compressor_stream(http_compressor_t *compressor, bool gzip) {
+    z_stream *stream = gzip ? &compressor->gzip : &compressor->deflate;
+    bool *ready = gzip ? &compressor->gzip_ready : &compressor->deflate_ready;
+
+    if (*ready) {
+        return deflateReset(stream) == Z_OK ? stream : NULL;
+    }
+
+    memset(stream, 0, sizeof(z_stream));
+    // windowBits + 16 produce l'involucro gzip; "deflate" in HTTP è il formato zlib
+    if (deflateInit2(stream, compressor->level, Z_DEFLATED, gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+
+    *ready = true;
+    return stream;
+}
+
+// Comprime il body della risposta se il client lo accetta e il body supera
+// la soglia. Ritorna 0 anche quando la risposta resta invariata, -1 solo se
+// la compressione fallisce (la risposta resta comunque valida)
+int http_compress_response(http_compressor_t *compressor, const http_request_t *request, http_response_t *response) {
+    if (compressor->level <= 0 || response->body_length < compressor->min_size || response->prebuilt ||
+        response->known_headers[HTTP_HEADER_CONTENT_ENCODING] ||
+        response->status_code == HTTP_NO_CONTENT || response->status_code == HTTP_NOT_MODIFIED) {
+        return 0;
+    }
+
+    // La rappresentazione dipende da Accept-Encoding anche se poi non si comprime
+    add_response_vary(response, "Accept-Encoding");
+
+    const char *accept = http_request_header(request, HTTP_HEADER_ACCEPT_ENCODING);
+    if (!accept) {
+        return 0;
+    }
+
+    int gzip_quality = coding_quality(accept, "gzip");
+    int deflate_quality = coding_quality(accept, "deflate");
+    bool gzip = gzip_quality > 0 && gzip_quality >= deflate_quality;
+    if (!gzip && deflate_quality <= 0) {
+        return 0;
+    }
+
+    z_stream *stream = compressor_stream(compressor, gzip);
+    if (!stream) {
+        return -1;
+    }
+
+    size_t bound = deflateBound(stream, response->body_length);
+    if (bound > compressor->capacity) {
+        unsigned char *buffer = realloc(compressor->buffer, bound);
+        if (!buffer) {
+            return -1;
+        }
+        compressor->buffer = buffer;
+        compressor->capacity = bound;
+    }
+
+    stream->next_in = (Bytef *)http_response_body(response);
+    stream->avail_in = response->body_length;
+    stream->next_out = compressor->buffer;
+    stream->avail_out = compressor->capacity;
+
+    if (deflate(stream, Z_FINISH) != Z_STREAM_END) {
+        return -1;
+    }
+
+    // Dati già compressi o casuali possono crescere: meglio l'originale
+    size_t compressed = stream->total_out;
+    if (compressed >= response->body_length) {
+        return 0;
+    }
+
+    if (set_response_body_length(response, (const char *)compressor->buffer, compressed, NULL) != 0) {
+        return -1;
+    }
+    return add_response_header(response, "Content-Encoding", gzip ? "gzip" : "deflate");
+}
@@ -0,0 +1,120 @@
+// http_scan.c
+//
+// Ricerca dei delimitatori di request line e header (CR/LF, ':', spazio)
+// 16 o 32 byte alla volta. Le versioni SIMD sono compilate con l'attributo
+// target, quindi il binario gira anche su CPU senza SSE4.2/AVX2: la scelta
+// avviene a runtime in http_scan_init.
+
+#include "http_scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HTTP_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+static const char* scan_any2_scalar(const char *p, const char *end, char a, char b) {
+    while (p < end && *p != a && *p != b) {
+        p++;
+    }
+    return p;
+}
+
+#ifdef HTTP_SCAN_X86
+
+// pcmpestri con EQUAL_ANY: un'istruzione confronta 16 byte con l'insieme {a, b}
+__attribute__((target("sse4.2")))
+static const char* scan_any2_sse42(const char *p, const char *end, char a, char b) {
+    const __m128i set = _mm_setr_epi8(a, b, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+        int index = _mm_cmpestri(set, 2, chunk, 16,
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+        if (index < 16) {
+            return p + index;
+        }
+        p += 16;
+    }
+
+    return scan_any2_scalar(p, end, a, b);
+}
+
+// Due confronti da 32 byte e una maschera: il primo bit acceso è il delimitatore
+__attribute__((target("avx2")))
+static const char* scan_any2_avx2(const char *p, const char *end, char a, char b) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(hit);
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+
+    // Coda di meno di 32 byte: AVX2 implica SSE4.2
+    return scan_any2_sse42(p, end, a, b);
+}
+
+#endif
+
+http_scan_fn http_scan_impl = scan_any2_scalar;
+static http_scan_level_t current_level = HTTP_SCAN_SCALAR;
+
+static int http_scan_supported(http_scan_level_t level) {
+    switch (level) {
+        case HTTP_SCAN_SCALAR:
+            return 1;
+#ifdef HTTP_SCAN_X86
+        case HTTP_SCAN_SSE42:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.2");
+        case HTTP_SCAN_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return 0;
+    }
+}
+
+// Forza una versione specifica (usato dal benchmark). Va chiamata prima di
+// avviare i thread che fanno parsing; -1 se la CPU non la supporta.
+int http_scan_select(http_scan_level_t level) {
+    if (!http_scan_supported(level)) {
+        return -1;
+    }
+
+    switch (level) {
+#ifdef HTTP_SCAN_X86
+        case HTTP_SCAN_SSE42: http_scan_impl = scan_any2_sse42; break;
+        case HTTP_SCAN_AVX2: http_scan_impl = scan_any2_avx2; break;
+#endif
+        default: http_scan_impl = scan_any2_scalar; break;
+    }
+
+    current_level = level;
+    return 0;
+}
+
+// Sceglie la versione migliore supportata dalla CPU
+void http_scan_init(void) {
+    if (http_scan_select(HTTP_SCAN_AVX2) == 0) return;
+    if (http_scan_select(HTTP_SCAN_SSE42) == 0) return;
+    http_scan_select(HTTP_SCAN_SCALAR);
+}
+
+http_scan_level_t http_scan_level(void) {
+    return current_level;
+}
+
+const char* http_scan_level_name(http_scan_level_t level) {
+    switch (level) {
+        case HTTP_SCAN_SSE42: return "sse4.2";
+        case HTTP_SCAN_AVX2: return "avx2";
+        default: return "scalare";
+    }
+}
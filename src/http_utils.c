@@ -1,16 +1,29 @@
+#include <pthread.h>
 #include "http_utils.h"
+#include "http_scan.h"
+
+// I metodi sono case-sensitive (RFC 9110, 9.1): la lunghezza e il primo
+// carattere individuano l'unico candidato, che si conferma con un memcmp
+http_method_t http_method_lookup(const char *name, size_t length) {
+    http_method_t method = HTTP_UNKNOWN;
+
+    switch (length) {
+        case 3: method = (name[0] == 'G') ? HTTP_GET : (name[0] == 'P') ? HTTP_PUT : HTTP_UNKNOWN; break;
+        case 4: method = (name[0] == 'P') ? HTTP_POST : (name[0] == 'H') ? HTTP_HEAD : HTTP_UNKNOWN; break;
+        case 5: method = (name[0] == 'P') ? HTTP_PATCH : (name[0] == 'T') ? HTTP_TRACE : HTTP_UNKNOWN; break;
+        case 6: method = HTTP_DELETE; break;
+        case 7: method = (name[0] == 'O') ? HTTP_OPTIONS : (name[0] == 'C') ? HTTP_CONNECT : HTTP_UNKNOWN; break;
+        default: break;
+    }
+
+    if (method != HTTP_UNKNOWN && memcmp(name, method_to_string(method), length) != 0) {
+        method = HTTP_UNKNOWN;
+    }
+    return method;
+}
 
 http_method_t string_to_method(const char *method_str) {
-    if (strcasecmp(method_str, "GET") == 0) return HTTP_GET;
-    if (strcasecmp(method_str, "POST") == 0) return HTTP_POST;
-    if (strcasecmp(method_str, "PUT") == 0) return HTTP_PUT;
-    if (strcasecmp(method_str, "DELETE") == 0) return HTTP_DELETE;
-    if (strcasecmp(method_str, "HEAD") == 0) return HTTP_HEAD;
-    if (strcasecmp(method_str, "OPTIONS") == 0) return HTTP_OPTIONS;
-    if (strcasecmp(method_str, "PATCH") == 0) return HTTP_PATCH;
-    if (strcasecmp(method_str, "TRACE") == 0) return HTTP_TRACE;
-    if (strcasecmp(method_str, "CONNECT") == 0) return HTTP_CONNECT;
-    return HTTP_UNKNOWN;
+    return http_method_lookup(method_str, strlen(method_str));
 }
 
 const char* method_to_string(http_method_t method) {
@@ -29,6 +42,116 @@ const char* method_to_string(http_method_t method) {
     }
 }
 
+static const struct {
+    const char *name;
+    size_t length;
+} known_headers[HTTP_KNOWN_HEADER_COUNT] = {
+    [HTTP_HEADER_HOST] = { "Host", 4 },
+    [HTTP_HEADER_ACCEPT] = { "Accept", 6 },
+    [HTTP_HEADER_DATE] = { "Date", 4 },
+    [HTTP_HEADER_ETAG] = { "ETag", 4 },
+    [HTTP_HEADER_VARY] = { "Vary", 4 },
+    [HTTP_HEADER_SERVER] = { "Server", 6 },
+    [HTTP_HEADER_CONNECTION] = { "Connection", 10 },
+    [HTTP_HEADER_CONTENT_TYPE] = { "Content-Type", 12 },
+    [HTTP_HEADER_IF_NONE_MATCH] = { "If-None-Match", 13 },
+    [HTTP_HEADER_CONTENT_LENGTH] = { "Content-Length", 14 },
+    [HTTP_HEADER_ACCEPT_ENCODING] = { "Accept-Encoding", 15 },
+    [HTTP_HEADER_CONTENT_ENCODING] = { "Content-Encoding", 16 },
+    [HTTP_HEADER_TRANSFER_ENCODING] = { "Transfer-Encoding", 17 },
+};
+
+// Come per i metodi: lunghezza e primo carattere scelgono il candidato, un
+// solo confronto (case-insensitive, come vogliono i nomi degli header) lo conferma
+http_known_header_t http_header_lookup(const char *name, size_t length) {
+    http_known_header_t header = HTTP_HEADER_UNKNOWN;
+    char first = (char)tolower((unsigned char)name[0]);
+
+    switch (length) {
+        case 4:
+            header = (first == 'h') ? HTTP_HEADER_HOST
+                   : (first == 'd') ? HTTP_HEADER_DATE
+                   : (first == 'e') ? HTTP_HEADER_ETAG
+                   : (first == 'v') ? HTTP_HEADER_VARY : HTTP_HEADER_UNKNOWN;
+            break;
+        case 6: header = (first == 'a') ? HTTP_HEADER_ACCEPT : HTTP_HEADER_SERVER; break;
+        case 10: header = HTTP_HEADER_CONNECTION; break;
+        case 12: header = HTTP_HEADER_CONTENT_TYPE; break;
+        case 13: header = HTTP_HEADER_IF_NONE_MATCH; break;
+        case 14: header = HTTP_HEADER_CONTENT_LENGTH; break;
+        case 15: header = HTTP_HEADER_ACCEPT_ENCODING; break;
+        case 16: header = HTTP_HEADER_CONTENT_ENCODING; break;
+        case 17: header = HTTP_HEADER_TRANSFER_ENCODING; break;
+        default: break;
+    }
+
+    if (header != HTTP_HEADER_UNKNOWN && strncasecmp(name, known_headers[header].name, length) != 0) {
+        header = HTTP_HEADER_UNKNOWN;
+    }
+    return header;
+}
+
+// Valore di un parametro q ("0", "0.5", "1.000") in millesimi
+static int parse_quality(const char **cursor) {
+    const char *p = *cursor;
+    int quality = 0;
+
+    if (*p == '1') {
+        quality = 1000;
+    } else if (*p != '0') {
+        return 0;
+    }
+    p++;
+
+    if (*p == '.') {
+        p++;
+        for (int scale = 100; isdigit((unsigned char)*p); p++, scale /= 10) {
+            if (quality < 1000) {
+                quality += (*p - '0') * scale;
+            }
+        }
+    }
+
+    *cursor = p;
+    return quality;
+}
+
+// Peso (q in millesimi) che un header a lista pesata come Accept o
+// Accept-Encoding dà esattamente a value; -1 se value non compare.
+// Le forme generiche ("*", "*/*") le cerca il chiamante
+int http_header_quality(const char *header, const char *value) {
+    size_t value_length = strlen(value);
+    const char *p = header;
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+
+        const char *name = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') p++;
+        size_t name_length = p - name;
+
+        int quality = 1000;
+        while (*p && *p != ',') {
+            if (*p != ';') {
+                p++;
+                continue;
+            }
+            p++;
+            while (*p == ' ' || *p == '\t') p++;
+            if ((*p == 'q' || *p == 'Q') && p[1] == '=') {
+                p += 2;
+                quality = parse_quality(&p);
+            }
+        }
+
+        if (name_length == value_length && strncasecmp(name, value, value_length) == 0) {
+            return quality;
+        }
+    }
+
+    return -1;
+}
+
 void trim_whitespace(char *str) {
     char *end;
     
@@ -75,237 +198,548 @@ void url_decode(char *dst, const char *src) {
     *d = '\0';
 }
 
-int parse_request_line(const char *line, http_request_t *request) {
-    char method[MAX_METHOD_LEN];
-    char uri[MAX_URI_LEN];
-    char version[MAX_VERSION_LEN];
-    
-    if (sscanf(line, "%15s %2047s %15s", method, uri, version) != 3) {
+// Le viste usano offset a 16 bit: tutto ciò che precede il body deve starci
+_Static_assert(HTTP_MAX_HEADER_SECTION <= UINT16_MAX, "HTTP_MAX_HEADER_SECTION non entra in http_view_t");
+
+static http_view_t make_view(const char *data, const char *start, size_t length) {
+    http_view_t view = { (uint16_t)(start - data), (uint16_t)length };
+    return view;
+}
+
+// data[start..end) è la request line, già terminata da '\0' in end. I tre
+// campi vengono terminati in place e diventano viste sul buffer
+int parse_request_line(char *data, size_t start, size_t end, http_request_t *request) {
+    char *line = data + start;
+    char *line_end = data + end;
+
+    char *method_end = (char *)http_scan_find(line, line_end, ' ', ' ');
+    if (method_end == line_end || method_end == line || method_end - line >= MAX_METHOD_LEN) {
         return -1;
     }
-    
+
+    char *uri = method_end;
+    while (*uri == ' ') uri++;
+
+    // Un solo passaggio sull'URI trova sia l'inizio della query sia la fine
+    char *query_start = NULL;
+    char *uri_end = (char *)http_scan_find(uri, line_end, ' ', '?');
+    if (uri_end < line_end && *uri_end == '?') {
+        query_start = uri_end;
+        uri_end = (char *)http_scan_find(query_start, line_end, ' ', ' ');
+    }
+
+    if (uri_end == line_end || uri_end == uri || uri_end - uri >= MAX_URI_LEN) {
+        return -1;
+    }
+
+    char *version = uri_end;
+    while (*version == ' ') version++;
+
+    while (line_end > version && isspace((unsigned char)line_end[-1])) line_end--;
+    if (line_end == version || line_end - version >= MAX_VERSION_LEN) {
+        return -1;
+    }
+
+    *method_end = '\0';
+    *uri_end = '\0';
+    *line_end = '\0';
+
     // Parsing del metodo
-    strncpy(request->method_str, method, MAX_METHOD_LEN - 1);
-    request->method_str[MAX_METHOD_LEN - 1] = '\0';
-    request->method = string_to_method(method);
-    
-    // Parsing dell'URI
-    strncpy(request->uri, uri, MAX_URI_LEN - 1);
-    request->uri[MAX_URI_LEN - 1] = '\0';
-    
+    request->method_str = make_view(data, line, method_end - line);
+    request->method = http_method_lookup(line, method_end - line);
+
     // Separazione path e query string
-    char *query_start = strchr(uri, '?');
     if (query_start) {
         *query_start = '\0';
-        strncpy(request->path, uri, MAX_URI_LEN - 1);
-        request->path[MAX_URI_LEN - 1] = '\0';
-        
-        strncpy(request->query_string, query_start + 1, MAX_URI_LEN - 1);
-        request->query_string[MAX_URI_LEN - 1] = '\0';
-        
-        parse_query_string(request->query_string, request);
-        *query_start = '?'; // Ripristina l'URI originale
+        parse_query_string(data, query_start + 1 - data, uri_end - data, request);
+        request->path = make_view(data, uri, query_start - uri);
     } else {
-        strncpy(request->path, uri, MAX_URI_LEN - 1);
-        request->path[MAX_URI_LEN - 1] = '\0';
-        request->query_string[0] = '\0';
+        request->path = make_view(data, uri, uri_end - uri);
     }
-    
+
     // Parsing della versione
-    strncpy(request->version, version, MAX_VERSION_LEN - 1);
-    request->version[MAX_VERSION_LEN - 1] = '\0';
-    
+    request->version = make_view(data, version, line_end - version);
+
     return 0;
 }
 
-int parse_header_line(const char *line, http_request_t *request) {
-    if (request->header_count >= MAX_HEADERS) {
+// Esito di parse_header_fields per un header che rende ambigua la lunghezza
+// del body: a differenza degli altri header malformati è un errore fatale
+#define HEADER_FRAMING_ERROR (-2)
+
+// Content-Length è 1*DIGIT (RFC 7230, 3.3.2): niente segni, spazi o suffissi
+static int parse_content_length(const char *value, size_t *length) {
+    size_t result = 0;
+
+    if (*value == '\0') {
         return -1;
     }
-    
-    char *colon = strchr(line, ':');
-    if (!colon) {
-        return -1;
+
+    for (const char *p = value; *p != '\0'; p++) {
+        if (*p < '0' || *p > '9') {
+            return -1;
+        }
+
+        size_t digit = (size_t)(*p - '0');
+        if (result > (SIZE_MAX - digit) / 10) {
+            return -1;
+        }
+        result = result * 10 + digit;
     }
-    
-    size_t name_len = colon - line;
-    if (name_len >= MAX_HEADER_NAME_LEN) {
+
+    *length = result;
+    return 0;
+}
+
+// data[start..end) è una riga di header terminata da '\0' in end, con il ':'
+// in colon. Nome e valore vengono ripuliti dagli spazi e terminati in place
+static int parse_header_fields(char *data, size_t start, size_t colon_pos, size_t end, http_request_t *request) {
+    if (request->header_count >= MAX_HEADERS) {
         return -1;
     }
-    
-    // Parsing del nome dell'header
-    strncpy(request->headers[request->header_count].name, line, name_len);
-    request->headers[request->header_count].name[name_len] = '\0';
-    trim_whitespace(request->headers[request->header_count].name);
-    
-    // Parsing del valore dell'header
-    strncpy(request->headers[request->header_count].value, colon + 1, MAX_HEADER_VALUE_LEN - 1);
-    request->headers[request->header_count].value[MAX_HEADER_VALUE_LEN - 1] = '\0';
-    trim_whitespace(request->headers[request->header_count].value);
-    
-    // Aggiorna content_length se è Content-Length
-    if (strcasecmp(request->headers[request->header_count].name, "Content-Length") == 0) {
-        request->content_length = strtoul(request->headers[request->header_count].value, NULL, 10);
+
+    char *line = data + start;
+    char *colon = data + colon_pos;
+    char *name = line;
+    while (name < colon && isspace((unsigned char)*name)) name++;
+
+    char *name_end = colon;
+    while (name_end > name && isspace((unsigned char)name_end[-1])) name_end--;
+
+    if (name_end == name || (size_t)(name_end - name) >= MAX_HEADER_NAME_LEN) {
+        return -1;
     }
-    
+
+    char *value = colon + 1;
+    char *value_end = data + end;
+    while (value < value_end && isspace((unsigned char)*value)) value++;
+    while (value_end > value && isspace((unsigned char)value_end[-1])) value_end--;
+
+    *name_end = '\0';
+    *value_end = '\0';
+
+    http_header_view_t *header = &request->headers[request->header_count];
+    header->name = make_view(data, name, name_end - name);
+    header->value = make_view(data, value, value_end - value);
     request->header_count++;
-    return 0;
-}
 
-int parse_query_string(const char *query_string, http_request_t *request) {
-    if (!query_string || strlen(query_string) == 0) {
+    http_known_header_t known = http_header_lookup(name, name_end - name);
+    if (known == HTTP_HEADER_CONTENT_LENGTH) {
+        // Un valore invalido o ripetuto con valori diversi rende la lunghezza
+        // ambigua (request smuggling); la ripetizione identica è ammessa
+        size_t content_length;
+        if (parse_content_length(value, &content_length) != 0) {
+            return HEADER_FRAMING_ERROR;
+        }
+        if (request->known_headers[known] != 0 && content_length != request->content_length) {
+            return HEADER_FRAMING_ERROR;
+        }
+        request->content_length = content_length;
+    }
+
+    if (known == HTTP_HEADER_UNKNOWN || request->known_headers[known] != 0) {
         return 0;
     }
-    
-    char *query_copy = strdup(query_string);
-    if (!query_copy) {
+    request->known_headers[known] = (uint8_t)request->header_count;
+
+    return 0;
+}
+
+int parse_header_line(char *data, size_t start, size_t end, http_request_t *request) {
+    const char *colon = http_scan_find(data + start, data + end, ':', ':');
+    if (colon == data + end) {
         return -1;
     }
-    
-    char *param = strtok(query_copy, "&");
-    while (param && request->query_param_count < MAX_QUERY_PARAMS) {
-        char *equals = strchr(param, '=');
-        if (equals) {
-            *equals = '\0';
-            
-            url_decode(request->query_params[request->query_param_count].name, param);
-            url_decode(request->query_params[request->query_param_count].value, equals + 1);
-        } else {
-            url_decode(request->query_params[request->query_param_count].name, param);
-            request->query_params[request->query_param_count].value[0] = '\0';
+
+    return parse_header_fields(data, start, colon - data, end, request);
+}
+
+// data[start..end) è la query string, terminata da '\0' in end. I parametri
+// vengono separati e decodificati in place: la decodifica non allunga mai il testo
+int parse_query_string(char *data, size_t start, size_t end, http_request_t *request) {
+    char *param = data + start;
+    char *query_end = data + end;
+
+    while (param < query_end && request->query_param_count < MAX_QUERY_PARAMS) {
+        char *param_end = memchr(param, '&', query_end - param);
+        if (!param_end) {
+            param_end = query_end;
+        }
+        *param_end = '\0';
+
+        if (param_end != param) {
+            query_param_t *query_param = &request->query_params[request->query_param_count];
+            char *equals = memchr(param, '=', param_end - param);
+            char *value = param_end;
+
+            if (equals) {
+                *equals = '\0';
+                value = equals + 1;
+                url_decode(value, value);
+            }
+            url_decode(param, param);
+
+            query_param->name = make_view(data, param, strlen(param));
+            query_param->value = make_view(data, value, strlen(value));
+            request->query_param_count++;
         }
-        
-        request->query_param_count++;
-        param = strtok(NULL, "&");
+
+        param = param_end + 1;
     }
-    
-    free(query_copy);
+
     return 0;
 }
 
+void http_request_init(http_request_t *request) {
+    memset(request, 0, sizeof(http_request_t));
+    request->method = HTTP_UNKNOWN;
+}
+
 http_request_t* create_http_request() {
-    http_request_t *request = calloc(1, sizeof(http_request_t));
+    http_request_t *request = malloc(sizeof(http_request_t));
     if (!request) {
         return NULL;
     }
-    
-    request->method = HTTP_UNKNOWN;
-    request->header_count = 0;
-    request->query_param_count = 0;
-    request->body = NULL;
-    request->body_length = 0;
-    request->content_length = 0;
-    
+
+    http_request_init(request);
     return request;
 }
 
+// Consegna alla richiesta completa il buffer che la contiene. Il buffer deve
+// avere un byte libero dopo la richiesta per terminare il body
+void http_request_set_buffer(http_request_t *request, char *buffer, size_t body_start) {
+    request->buffer = buffer;
+    request->body = NULL;
+
+    if (request->body_length > 0) {
+        request->body = buffer + body_start;
+        request->body[request->body_length] = '\0';
+    }
+}
+
+// Libera il buffer: tutte le viste e il body smettono di essere valide
+void http_request_clear(http_request_t *request) {
+    free(request->buffer);
+    request->buffer = NULL;
+    request->body = NULL;
+}
+
 void free_http_request(http_request_t *request) {
     if (request) {
-        if (request->body) {
-            free(request->body);
-        }
+        http_request_clear(request);
         free(request);
     }
 }
 
-int parse_http_request(const char *raw_request, http_request_t *request) {
-    if (!raw_request || !request) {
-        return -1;
-    }
-    
-    // Trova il separatore tra headers e body
-    const char *header_end = strstr(raw_request, "\r\n\r\n");
-    if (!header_end) {
-        // Prova con solo \n se non trova \r\n\r\n
-        header_end = strstr(raw_request, "\n\n");
-        if (!header_end) {
-            return -1;
+void http_parser_init(http_parser_t *parser) {
+    memset(parser, 0, sizeof(http_parser_t));
+    parser->state = HTTP_PARSE_REQUEST_LINE;
+    parser->max_body_size = HTTP_MAX_BODY_SIZE;
+    parser->error = HTTP_BAD_REQUEST;
+}
+
+static http_parse_state_t parser_fail(http_parser_t *parser, http_status_t status) {
+    parser->state = HTTP_PARSE_ERROR;
+    parser->error = status;
+    return parser->state;
+}
+
+// Fine degli headers: sceglie come delimitare il body (RFC 7230, 3.3.3)
+static http_parse_state_t start_body(http_parser_t *parser, http_request_t *request, char *data) {
+    uint8_t transfer_encoding = request->known_headers[HTTP_HEADER_TRANSFER_ENCODING];
+
+    if (transfer_encoding != 0) {
+        // Con entrambi gli headers la lunghezza è ambigua (request smuggling),
+        // qualunque sia la codifica dichiarata
+        if (request->known_headers[HTTP_HEADER_CONTENT_LENGTH] != 0) {
+            return parser_fail(parser, HTTP_BAD_REQUEST);
         }
+
+        const char *coding = data + request->headers[transfer_encoding - 1].value.offset;
+        if (strcasecmp(coding, "chunked") != 0) {
+            return parser_fail(parser, HTTP_NOT_IMPLEMENTED);
+        }
+
+        parser->chunked = true;
+        parser->chunk_state = HTTP_CHUNK_SIZE;
+        parser->state = HTTP_PARSE_BODY;
+        return parser->state;
     }
-    
-    // Calcola la lunghezza della parte headers
-    size_t header_length = header_end - raw_request;
-    
-    // Crea una copia solo della parte headers
-    char *headers_copy = malloc(header_length + 1);
-    if (!headers_copy) {
-        return -1;
+
+    if (request->content_length > parser->max_body_size) {
+        return parser_fail(parser, HTTP_PAYLOAD_TOO_LARGE);
     }
-    
-    strncpy(headers_copy, raw_request, header_length);
-    headers_copy[header_length] = '\0';
-    
-    // Parsing delle linee degli headers
-    char *line = strtok(headers_copy, "\r\n");
-    if (!line) {
-        // Prova con solo \n
-        free(headers_copy);
-        headers_copy = malloc(header_length + 1);
-        strncpy(headers_copy, raw_request, header_length);
-        headers_copy[header_length] = '\0';
-        line = strtok(headers_copy, "\n");
-        if (!line) {
-            free(headers_copy);
-            return -1;
+
+    parser->state = (request->content_length > 0) ? HTTP_PARSE_BODY : HTTP_PARSE_COMPLETE;
+    return parser->state;
+}
+
+// Riga "dimensione[;estensioni]" di un chunk, tra line ed end
+static int parse_chunk_size(const char *line, const char *end, size_t limit, size_t *size) {
+    size_t value = 0;
+    const char *p = line;
+
+    while (p < end && isxdigit((unsigned char)*p)) {
+        if (value > limit) {
+            // Il resto delle cifre non cambia l'esito: già oltre il limite
+            *size = value;
+            return 0;
         }
+        int digit = isdigit((unsigned char)*p) ? *p - '0' : (tolower((unsigned char)*p) - 'a' + 10);
+        value = value * 16 + digit;
+        p++;
     }
-    
-    // Parsing della request line
-    if (parse_request_line(line, request) != 0) {
-        free(headers_copy);
+
+    if (p == line) {
         return -1;
     }
-    
-    // Parsing degli headers
-    while ((line = strtok(NULL, "\r\n")) != NULL || (line = strtok(NULL, "\n")) != NULL) {
-        if (strlen(line) == 0) {
-            break; // Fine degli headers
-        }
-        if (parse_header_line(line, request) != 0) {
-            // Non considerare un errore critico un header malformato
+
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p < end && *p != ';') {
+        return -1;
+    }
+
+    *size = value;
+    return 0;
+}
+
+// Decodifica incrementale di un body chunked. I dati di ogni chunk vengono
+// spostati subito dopo quelli già decodificati, a partire da body_start: a
+// fine richiesta il body è contiguo come con Content-Length
+static http_parse_state_t parse_chunked_body(http_parser_t *parser, http_request_t *request,
+                                             char *data, size_t length) {
+    const char *data_end = data + length;
+
+    while (parser->state == HTTP_PARSE_BODY) {
+        if (parser->chunk_state == HTTP_CHUNK_DATA) {
+            size_t available = length - parser->scan_pos;
+            size_t n = available < parser->chunk_remaining ? available : parser->chunk_remaining;
+
+            if (n > 0) {
+                memmove(data + parser->body_start + request->body_length, data + parser->scan_pos, n);
+                request->body_length += n;
+                parser->scan_pos += n;
+                parser->chunk_remaining -= n;
+            }
+
+            if (parser->chunk_remaining > 0) {
+                return parser->state; // Servono altri dati
+            }
+
+            parser->chunk_state = HTTP_CHUNK_DATA_END;
+            parser->line_start = parser->scan_pos;
             continue;
         }
-    }
-    
-    free(headers_copy);
-    
-    // Parsing del body se presente
-    const char *body_start = strstr(raw_request, "\r\n\r\n");
-    if (body_start) {
-        body_start += 4; // Salta "\r\n\r\n"
-    } else {
-        body_start = strstr(raw_request, "\n\n");
-        if (body_start) {
-            body_start += 2; // Salta "\n\n"
+
+        const char *newline = http_scan_find(data + parser->scan_pos, data_end, '\n', '\n');
+        if (newline == data_end) {
+            if (length - parser->line_start > HTTP_MAX_CHUNK_LINE) {
+                return parser_fail(parser, HTTP_BAD_REQUEST);
+            }
+            parser->scan_pos = length;
+            return parser->state;
+        }
+
+        size_t next_line = (newline - data) + 1;
+        size_t line_end = newline - data;
+        if (line_end > parser->line_start && data[line_end - 1] == '\r') {
+            line_end--;
+        }
+        if (line_end - parser->line_start > HTTP_MAX_CHUNK_LINE) {
+            return parser_fail(parser, HTTP_BAD_REQUEST);
+        }
+
+        char *line = data + parser->line_start;
+        bool empty = (line_end == parser->line_start);
+        parser->line_start = next_line;
+        parser->scan_pos = next_line;
+
+        switch (parser->chunk_state) {
+            case HTTP_CHUNK_SIZE: {
+                size_t size;
+                size_t limit = parser->max_body_size - request->body_length;
+                if (parse_chunk_size(line, data + line_end, limit, &size) != 0) {
+                    return parser_fail(parser, HTTP_BAD_REQUEST);
+                }
+                if (size > limit) {
+                    return parser_fail(parser, HTTP_PAYLOAD_TOO_LARGE);
+                }
+                parser->chunk_remaining = size;
+                parser->chunk_state = (size > 0) ? HTTP_CHUNK_DATA : HTTP_CHUNK_TRAILER;
+                break;
+            }
+            case HTTP_CHUNK_DATA_END:
+                if (!empty) {
+                    return parser_fail(parser, HTTP_BAD_REQUEST);
+                }
+                parser->chunk_state = HTTP_CHUNK_SIZE;
+                break;
+            default:
+                // Gli header del trailer non vengono conservati: la riga
+                // vuota chiude la richiesta
+                if (empty) {
+                    request->content_length = request->body_length;
+                    parser->request_length = next_line;
+                    parser->state = HTTP_PARSE_COMPLETE;
+                }
+                break;
         }
     }
-    
-    if (body_start) {
-        size_t total_length = strlen(raw_request);
-        size_t body_start_offset = body_start - raw_request;
-        size_t remaining = total_length - body_start_offset;
-        
-        if (request->content_length > 0) {
-            // Usa Content-Length se specificato
-            size_t body_size = (remaining < request->content_length) ? remaining : request->content_length;
-            request->body = malloc(body_size + 1);
-            if (request->body) {
-                memcpy(request->body, body_start, body_size);
-                request->body[body_size] = '\0';
-                request->body_length = body_size;
+
+    return parser->state;
+}
+
+// Con un body chunked i byte di framing già consumati restano tra il body
+// decodificato e i dati ancora da analizzare: li elimina spostando indietro
+// la parte non letta. Ritorna la nuova lunghezza dei dati in data, così il
+// buffer di ricezione cresce con il body decodificato e non con quello grezzo
+size_t http_parser_compact(http_parser_t *parser, const http_request_t *request, char *data, size_t length) {
+    if (!parser->chunked || parser->state != HTTP_PARSE_BODY) {
+        return length;
+    }
+
+    size_t write_pos = parser->body_start + request->body_length;
+    size_t keep_from = (parser->chunk_state == HTTP_CHUNK_DATA) ? parser->scan_pos : parser->line_start;
+    size_t shift = keep_from - write_pos;
+    if (shift == 0) {
+        return length;
+    }
+
+    memmove(data + write_pos, data + keep_from, length - keep_from);
+    parser->line_start = (parser->line_start > shift) ? parser->line_start - shift : write_pos;
+    parser->scan_pos -= shift;
+    return length - shift;
+}
+
+// Avanza il parsing su data[0..length), dove data contiene la richiesta a
+// partire dal primo byte. Può essere richiamata ogni volta che arrivano nuovi
+// dati: le righe già analizzate non vengono rilette. Ritorna lo stato
+// raggiunto; con HTTP_PARSE_COMPLETE parser->request_length indica quanti
+// byte consumare (eventuali byte successivi appartengono alla richiesta dopo).
+// Le righe complete vengono terminate in place e la richiesta conserva solo
+// offset: data può essere riallocato tra una chiamata e l'altra. Le funzioni
+// di accesso valgono solo dopo http_request_set_buffer, che cede data alla richiesta.
+// Con HTTP_PARSE_ERROR parser->error è lo status da rispondere al client.
+http_parse_state_t http_parser_execute(http_parser_t *parser, http_request_t *request, char *data, size_t length) {
+    if (!parser || !request || !data) {
+        return HTTP_PARSE_ERROR;
+    }
+
+    const char *data_end = data + length;
+
+    while (parser->state == HTTP_PARSE_REQUEST_LINE || parser->state == HTTP_PARSE_HEADERS) {
+        const char *newline;
+
+        if (parser->state == HTTP_PARSE_HEADERS && parser->colon == 0) {
+            // Un solo passaggio trova il ':' dell'header o la fine della riga
+            newline = http_scan_find(data + parser->scan_pos, data_end, ':', '\n');
+            if (newline < data_end && *newline == ':') {
+                parser->colon = newline - data;
+                parser->scan_pos = parser->colon + 1;
+                continue;
+            }
+        } else {
+            newline = http_scan_find(data + parser->scan_pos, data_end, '\n', '\n');
+        }
+
+        if (newline == data_end) {
+            parser->scan_pos = length;
+            if (length > HTTP_MAX_HEADER_SECTION) {
+                return parser_fail(parser, HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE);
+            }
+            return parser->state;
+        }
+
+        size_t next_line = (newline - data) + 1;
+        size_t line_end = newline - data;
+        if (line_end > parser->line_start && data[line_end - 1] == '\r') {
+            line_end--;
+        }
+
+        if (next_line > HTTP_MAX_HEADER_SECTION) {
+            return parser_fail(parser, HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE);
+        }
+
+        // La riga non verrà più riletta: la si termina definitivamente
+        data[line_end] = '\0';
+        int result = 0;
+
+        if (parser->state == HTTP_PARSE_REQUEST_LINE) {
+            // Righe vuote prima della request line vengono ignorate (RFC 7230, 3.5)
+            if (line_end != parser->line_start) {
+                result = parse_request_line(data, parser->line_start, line_end, request);
+                parser->state = HTTP_PARSE_HEADERS;
             }
-        } else if (remaining > 0) {
-            // Se non c'è Content-Length ma c'è del contenuto, prendilo tutto
-            request->body = malloc(remaining + 1);
-            if (request->body) {
-                memcpy(request->body, body_start, remaining);
-                request->body[remaining] = '\0';
-                request->body_length = remaining;
-                request->content_length = remaining;
+        } else if (line_end == parser->line_start) {
+            // Riga vuota: fine degli headers
+            parser->body_start = next_line;
+            start_body(parser, request, data);
+        } else if (parser->colon != 0) {
+            // Un header scartato per mancanza di spazio potrebbe essere
+            // Content-Length o Transfer-Encoding: meglio rifiutare la richiesta
+            if (request->header_count >= MAX_HEADERS) {
+                return parser_fail(parser, HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE);
             }
+            // Non considerare un errore critico un header malformato, salvo
+            // che renda ambigua la lunghezza del body
+            if (parse_header_fields(data, parser->line_start, parser->colon, line_end, request) == HEADER_FRAMING_ERROR) {
+                result = -1;
+            }
+        }
+
+        parser->colon = 0;
+        parser->line_start = next_line;
+        parser->scan_pos = next_line;
+
+        if (result != 0) {
+            return parser_fail(parser, HTTP_BAD_REQUEST);
         }
     }
-    
+
+    if (parser->state == HTTP_PARSE_BODY && parser->chunked) {
+        parse_chunked_body(parser, request, data, length);
+    } else if (parser->state == HTTP_PARSE_BODY) {
+        if (length - parser->body_start < request->content_length) {
+            return parser->state; // Servono altri dati
+        }
+
+        // Il body resta dov'è: http_request_set_buffer lo collega alla richiesta
+        request->body_length = request->content_length;
+        parser->request_length = parser->body_start + request->content_length;
+        parser->state = HTTP_PARSE_COMPLETE;
+    } else if (parser->state == HTTP_PARSE_COMPLETE && parser->request_length == 0) {
+        // Senza Content-Length la richiesta non ha body
+        parser->request_length = parser->body_start;
+    }
+
+    return parser->state;
+}
+
+// Parsing di una richiesta già interamente in memoria: la richiesta lavora su
+// una copia, che le appartiene e va liberata con http_request_clear
+int parse_http_request(const char *raw_request, http_request_t *request) {
+    if (!raw_request || !request) {
+        return -1;
+    }
+
+    size_t length = strlen(raw_request);
+    char *copy = malloc(length + 1);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, raw_request, length + 1);
+
+    http_parser_t parser;
+    http_parser_init(&parser);
+    http_parse_state_t state = http_parser_execute(&parser, request, copy, length);
+
+    if (state != HTTP_PARSE_COMPLETE) {
+        free(copy);
+        request->buffer = NULL;
+        return -1;
+    }
+
+    http_request_set_buffer(request, copy, parser.body_start);
     return 0;
 }
 
@@ -313,10 +747,15 @@ const char* get_header_value(const http_request_t *request, const char *header_n
     if (!request || !header_name) {
         return NULL;
     }
+
+    http_known_header_t known = http_header_lookup(header_name, strlen(header_name));
+    if (known != HTTP_HEADER_UNKNOWN) {
+        return http_request_header(request, known);
+    }
     
     for (int i = 0; i < request->header_count; i++) {
-        if (strcasecmp(request->headers[i].name, header_name) == 0) {
-            return request->headers[i].value;
+        if (strcasecmp(http_request_str(request, request->headers[i].name), header_name) == 0) {
+            return http_request_str(request, request->headers[i].value);
         }
     }
     
@@ -329,14 +768,53 @@ const char* get_query_param(const http_request_t *request, const char *param_nam
     }
     
     for (int i = 0; i < request->query_param_count; i++) {
-        if (strcmp(request->query_params[i].name, param_name) == 0) {
-            return request->query_params[i].value;
+        if (strcmp(http_request_str(request, request->query_params[i].name), param_name) == 0) {
+            return http_request_str(request, request->query_params[i].value);
         }
     }
     
     return NULL;
 }
 
+// Verifica se un header con lista di token (es. "Connection: keep-alive, Upgrade")
+// contiene il token indicato, senza distinguere maiuscole e minuscole
+static int header_has_token(const char *value, const char *token) {
+    size_t token_len = strlen(token);
+
+    while (value && *value) {
+        while (*value == ' ' || *value == '\t' || *value == ',') value++;
+
+        const char *end = value;
+        while (*end && *end != ',') end++;
+
+        const char *last = end;
+        while (last > value && (last[-1] == ' ' || last[-1] == '\t')) last--;
+
+        if ((size_t)(last - value) == token_len && strncasecmp(value, token, token_len) == 0) {
+            return 1;
+        }
+        value = end;
+    }
+
+    return 0;
+}
+
+// HTTP/1.1 è persistente di default salvo "Connection: close",
+// HTTP/1.0 lo è solo con "Connection: keep-alive"
+int http_request_keep_alive(const http_request_t *request) {
+    if (!request) {
+        return 0;
+    }
+
+    const char *connection = http_request_header(request, HTTP_HEADER_CONNECTION);
+
+    if (request->version.length == 8 && memcmp(http_request_str(request, request->version), "HTTP/1.1", 8) == 0) {
+        return !header_has_token(connection, "close");
+    }
+
+    return header_has_token(connection, "keep-alive");
+}
+
 int has_header(const http_request_t *request, const char *header_name) {
     return get_header_value(request, header_name) != NULL;
 }
@@ -352,21 +830,21 @@ void print_http_request(const http_request_t *request) {
     }
     
     printf("=== HTTP REQUEST ===\n");
-    printf("Method: %s (%s)\n", request->method_str, method_to_string(request->method));
-    printf("URI: %s\n", request->uri);
-    printf("Path: %s\n", request->path);
-    printf("Query String: %s\n", request->query_string);
-    printf("Version: %s\n", request->version);
+    printf("Method: %s (%s)\n", http_request_str(request, request->method_str), method_to_string(request->method));
+    printf("Path: %s\n", http_request_str(request, request->path));
+    printf("Version: %s\n", http_request_str(request, request->version));
     printf("Content Length: %zu\n", request->content_length);
     
     printf("\nHeaders (%d):\n", request->header_count);
     for (int i = 0; i < request->header_count; i++) {
-        printf("  %s: %s\n", request->headers[i].name, request->headers[i].value);
+        printf("  %s: %s\n", http_request_str(request, request->headers[i].name),
+               http_request_str(request, request->headers[i].value));
     }
     
     printf("\nQuery Parameters (%d):\n", request->query_param_count);
     for (int i = 0; i < request->query_param_count; i++) {
-        printf("  %s = %s\n", request->query_params[i].name, request->query_params[i].value);
+        printf("  %s = %s\n", http_request_str(request, request->query_params[i].name),
+               http_request_str(request, request->query_params[i].value));
     }
     
     if (request->body && request->body_length > 0) {
@@ -377,111 +855,310 @@ void print_http_request(const http_request_t *request) {
     printf("==================\n");
 }
 
-http_response_t* create_http_response() {
-    http_response_t *response = calloc(1, sizeof(http_response_t));
-    if (!response) {
+// Pool delle risposte: i worker le creano, i reactor le liberano dopo
+// l'invio, quindi la lista è condivisa e protetta da un mutex
+static pthread_mutex_t response_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static http_response_t *response_pool = NULL;
+static int response_pool_size = 0;
+
+// Garantisce length byte liberi (più il '\0') in fondo all'arena e ritorna
+// dove scriverli; l'arena può essere stata spostata
+static char* response_arena_reserve(http_response_t *response, size_t length) {
+    size_t needed = response->arena_used + length + 1;
+
+    if (needed > UINT32_MAX) {
         return NULL;
     }
-    
-    strcpy(response->version, "HTTP/1.1");
+
+    if (needed > response->arena_capacity) {
+        size_t new_capacity = response->arena_capacity ? response->arena_capacity * 2 : HTTP_RESPONSE_ARENA_SIZE;
+        while (new_capacity < needed) {
+            new_capacity *= 2;
+        }
+
+        char *arena = realloc(response->arena, new_capacity);
+        if (!arena) {
+            return NULL;
+        }
+        response->arena = arena;
+        response->arena_capacity = new_capacity;
+    }
+
+    return response->arena + response->arena_used;
+}
+
+// Copia data[0..length) in coda all'arena, seguito da '\0'; ritorna l'offset o -1
+static int64_t response_arena_push(http_response_t *response, const char *data, size_t length) {
+    char *out = response_arena_reserve(response, length);
+    if (!out) {
+        return -1;
+    }
+
+    size_t offset = response->arena_used;
+    memcpy(out, data, length);
+    out[length] = '\0';
+    response->arena_used += length + 1;
+    return (int64_t)offset;
+}
+
+// Riporta la risposta allo stato iniziale tenendo arena e buffer allocati
+static void response_reset(http_response_t *response) {
     response->status_code = HTTP_OK;
-    strcpy(response->status_message, status_to_message(HTTP_OK));
+    response->status_message = status_to_message(HTTP_OK);
     response->header_count = 0;
-    response->body = NULL;
+    memset(response->known_headers, 0, sizeof(response->known_headers));
+    response->body = 0;
     response->body_length = 0;
-    response->raw_response = NULL;
-    response->raw_response_size = 0;
-    
-    // Aggiungi header di default
-    add_response_header(response, "Date", get_current_time_string());
-    add_response_header(response, "Server", "HTTP-Parser/1.0");
-    add_response_header(response, "Connection", "close");
-    
-    return response;
+    response->arena_used = 0;
+    response->body_ref = NULL;
+    response->prebuilt = NULL;
+    response->keep_alive = -1;
+    response->iov_count = 0;
+    response->response_size = 0;
+    response->next_free = NULL;
 }
 
-void free_http_response(http_response_t *response) {
+http_response_t* create_http_response() {
+    pthread_mutex_lock(&response_pool_mutex);
+    http_response_t *response = response_pool;
     if (response) {
-        if (response->body) {
-            free(response->body);
-        }
-        if (response->raw_response) {
-            free(response->raw_response);
+        response_pool = response->next_free;
+        response_pool_size--;
+    }
+    pthread_mutex_unlock(&response_pool_mutex);
+
+    if (!response) {
+        response = calloc(1, sizeof(http_response_t));
+        if (!response) {
+            return NULL;
         }
-        free(response);
     }
+
+    // Date e Server vengono aggiunti da build_response
+    response_reset(response);
+    return response;
 }
 
+// La risposta torna nel pool; buffer cresciuti oltre il limite (es. l'elenco
+// di tutti i libri) vengono liberati per non restare occupati a lungo
+void free_http_response(http_response_t *response) {
+    if (!response) {
+        return;
+    }
+
+    if (response->arena_capacity > HTTP_RESPONSE_POOL_MAX_BUFFER) {
+        free(response->arena);
+        response->arena = NULL;
+        response->arena_capacity = 0;
+    }
+    if (response->head_capacity > HTTP_RESPONSE_POOL_MAX_BUFFER) {
+        free(response->head);
+        response->head = NULL;
+        response->head_capacity = 0;
+    }
+
+    pthread_mutex_lock(&response_pool_mutex);
+    if (response_pool_size < HTTP_RESPONSE_POOL_MAX) {
+        response->next_free = response_pool;
+        response_pool = response;
+        response_pool_size++;
+        response = NULL;
+    }
+    pthread_mutex_unlock(&response_pool_mutex);
 
+    if (response) {
+        free(response->arena);
+        free(response->head);
+        free(response);
+    }
+}
 
 int set_response_status(http_response_t *response, http_status_t status) {
     if (!response) {
         return -1;
     }
-    
+
     response->status_code = status;
-    strncpy(response->status_message, status_to_message(status), MAX_STATUS_MESSAGE_LEN - 1);
-    response->status_message[MAX_STATUS_MESSAGE_LEN - 1] = '\0';
-    
+    response->status_message = status_to_message(status);
+
+    return 0;
+}
+
+int set_response_keep_alive(http_response_t *response, int keep_alive) {
+    if (!response) {
+        return -1;
+    }
+
+    response->keep_alive = keep_alive ? 1 : 0;
     return 0;
 }
 
 int add_response_header(http_response_t *response, const char *name, const char *value) {
-    if (!response || !name || !value || response->header_count >= MAX_HEADERS) {
+    if (!response || !name || !value) {
         return -1;
     }
-    
-    // Controlla se l'header esiste già (per aggiornarlo)
-    for (int i = 0; i < response->header_count; i++) {
-        if (strcasecmp(response->headers[i].name, name) == 0) {
-            strncpy(response->headers[i].value, value, MAX_HEADER_VALUE_LEN - 1);
-            response->headers[i].value[MAX_HEADER_VALUE_LEN - 1] = '\0';
-            return 0;
+
+    size_t name_length = strlen(name);
+    size_t value_length = strlen(value);
+
+    // Controlla se l'header esiste già (per aggiornarlo): per gli header noti
+    // basta lo slot, gli altri si cercano nella lista
+    http_known_header_t known = http_header_lookup(name, name_length);
+    int existing = -1;
+
+    if (known != HTTP_HEADER_UNKNOWN) {
+        existing = response->known_headers[known] - 1;
+    } else {
+        for (int i = 0; i < response->header_count; i++) {
+            if (response->headers[i].name_length == name_length &&
+                strcasecmp(response->arena + response->headers[i].name, name) == 0) {
+                existing = i;
+                break;
+            }
         }
     }
-    
+
+    // Il valore precedente resta nell'arena fino al reset: costa meno che compattarla
+    int64_t value_offset = response_arena_push(response, value, value_length);
+    if (value_offset < 0) {
+        return -1;
+    }
+
+    if (existing >= 0) {
+        response->headers[existing].value = (uint32_t)value_offset;
+        response->headers[existing].value_length = (uint32_t)value_length;
+        return 0;
+    }
+
+    if (response->header_count >= MAX_HEADERS) {
+        return -1;
+    }
+
+    int64_t name_offset = response_arena_push(response, name, name_length);
+    if (name_offset < 0) {
+        return -1;
+    }
+
     // Aggiungi nuovo header
-    strncpy(response->headers[response->header_count].name, name, MAX_HEADER_NAME_LEN - 1);
-    response->headers[response->header_count].name[MAX_HEADER_NAME_LEN - 1] = '\0';
-    
-    strncpy(response->headers[response->header_count].value, value, MAX_HEADER_VALUE_LEN - 1);
-    response->headers[response->header_count].value[MAX_HEADER_VALUE_LEN - 1] = '\0';
-    
+    http_response_header_t *header = &response->headers[response->header_count];
+    header->name = (uint32_t)name_offset;
+    header->name_length = (uint32_t)name_length;
+    header->value = (uint32_t)value_offset;
+    header->value_length = (uint32_t)value_length;
+
     response->header_count++;
+    if (known != HTTP_HEADER_UNKNOWN) {
+        response->known_headers[known] = (uint8_t)response->header_count;
+    }
     return 0;
 }
 
-int set_response_body(http_response_t *response, const char *body, const char *content_type) {
-    if (!response || !body) {
-        return -1;
-    }
-    
-    // Libera il body precedente se esiste
-    if (response->body) {
-        free(response->body);
+// Aggiunge field a Vary: più moduli (formato, compressione) possono far
+// dipendere la stessa risposta da header diversi della richiesta
+int add_response_vary(http_response_t *response, const char *field) {
+    uint8_t slot = response->known_headers[HTTP_HEADER_VARY];
+    if (!slot) {
+        return add_response_header(response, "Vary", field);
     }
-    
-    size_t body_len = strlen(body);
-    response->body = malloc(body_len + 1);
-    if (!response->body) {
+
+    // Copia in stack: aggiungere l'header può spostare l'arena
+    char value[256];
+    int written = snprintf(value, sizeof(value), "%s, %s",
+                           response->arena + response->headers[slot - 1].value, field);
+    if (written < 0 || (size_t)written >= sizeof(value)) {
         return -1;
     }
-    
-    strcpy(response->body, body);
-    response->body_length = body_len;
-    
-    // Aggiorna gli header
+    return add_response_header(response, "Vary", value);
+}
+
+// Content-Length e Content-Type del body appena impostato
+static int set_body_headers(http_response_t *response, size_t length, const char *content_type) {
+    response->prebuilt = NULL;
+
     char content_length_str[32];
-    snprintf(content_length_str, sizeof(content_length_str), "%zu", body_len);
-    add_response_header(response, "Content-Length", content_length_str);
-    
+    snprintf(content_length_str, sizeof(content_length_str), "%zu", length);
+    if (add_response_header(response, "Content-Length", content_length_str) != 0) {
+        return -1;
+    }
+
     if (content_type) {
-        add_response_header(response, "Content-Type", content_type);
+        return add_response_header(response, "Content-Type", content_type);
     }
-    
+
     return 0;
 }
 
+// Copia length byte di body nell'arena: il body può contenere '\0'
+int set_response_body_length(http_response_t *response, const char *body, size_t length, const char *content_type) {
+    if (!response || (!body && length > 0)) {
+        return -1;
+    }
+
+    int64_t offset = response_arena_push(response, body ? body : "", length);
+    if (offset < 0) {
+        return -1;
+    }
+
+    response->body = (uint32_t)offset;
+    response->body_length = length;
+    response->body_ref = NULL;
+
+    return set_body_headers(response, length, content_type);
+}
+
+int set_response_body(http_response_t *response, const char *body, const char *content_type) {
+    if (!body) {
+        return -1;
+    }
+
+    return set_response_body_length(response, body, strlen(body), content_type);
+}
+
+// Body inviato direttamente da body senza copiarlo (stringhe statiche, dati
+// in cache): deve restare valido finché la risposta non viene liberata
+int set_response_body_ref(http_response_t *response, const char *body, size_t length, const char *content_type) {
+    if (!response || (!body && length > 0)) {
+        return -1;
+    }
+
+    response->body_ref = body;
+    response->body_length = length;
+
+    return set_body_headers(response, length, content_type);
+}
+
+
+// Body scritto a pezzi direttamente in fondo all'arena (es. da json_writer):
+// tra http_response_body_begin e http_response_body_end non si possono
+// aggiungere header, che userebbero la stessa arena
+void http_response_body_begin(http_response_t *response) {
+    response->body = (uint32_t)response->arena_used;
+    response->body_length = 0;
+    response->body_ref = NULL;
+    response->prebuilt = NULL;
+}
+
+// Spazio per almeno length byte dopo il body corrente, da confermare con
+// http_response_body_commit; NULL se l'arena non può crescere
+char* http_response_body_reserve(http_response_t *response, size_t length) {
+    return response_arena_reserve(response, length);
+}
+
+void http_response_body_commit(http_response_t *response, size_t length) {
+    response->arena_used += length;
+    response->body_length += length;
+}
+
+int http_response_body_end(http_response_t *response, const char *content_type) {
+    char *end = response_arena_reserve(response, 0);
+    if (!end) {
+        return -1;
+    }
+
+    *end = '\0';
+    response->arena_used++;
+    return set_body_headers(response, response->body_length, content_type);
+}
 
 int set_response_json(http_response_t *response, const char *json) {
     return set_response_body(response, json, "application/json; charset=utf-8");
@@ -495,90 +1172,197 @@ int set_response_text(http_response_t *response, const char *text) {
     return set_response_body(response, text, "text/plain; charset=utf-8");
 }
 
-int build_response(http_response_t *response) {
-    if (!response) {
+int http_prebuilt_body_init(http_prebuilt_body_t *prebuilt, const char *body, const char *content_type) {
+    prebuilt->body = body;
+    prebuilt->body_length = strlen(body);
+
+    int written = snprintf(prebuilt->headers, sizeof(prebuilt->headers),
+                           "Content-Length: %zu\r\nContent-Type: %s\r\n", prebuilt->body_length, content_type);
+    if (written < 0 || (size_t)written >= sizeof(prebuilt->headers)) {
         return -1;
     }
-    
-    // Libera la risposta precedente se esiste
-    if (response->raw_response) {
-        free(response->raw_response);
-    }
-    
-    // Alloca buffer per la risposta
-    response->raw_response = malloc(MAX_RESPONSE_SIZE);
-    if (!response->raw_response) {
+
+    prebuilt->headers_length = written;
+    return 0;
+}
+
+// Body costante preparato con http_prebuilt_body_init: nessuna copia e nessun
+// header da formattare
+int set_response_prebuilt_body(http_response_t *response, const http_prebuilt_body_t *prebuilt) {
+    if (!response || !prebuilt) {
         return -1;
     }
-    
-    // Costruisci la status line
-    int written = snprintf(response->raw_response, MAX_RESPONSE_SIZE,
-                          "%s %d %s\r\n",
-                          response->version,
-                          response->status_code,
-                          response->status_message);
-    
-    if (written >= MAX_RESPONSE_SIZE) {
-        free(response->raw_response);
-        response->raw_response = NULL;
+
+    response->body_ref = prebuilt->body;
+    response->body_length = prebuilt->body_length;
+    response->prebuilt = prebuilt;
+    return 0;
+}
+
+static char* append_bytes(char *out, const char *data, size_t length) {
+    memcpy(out, data, length);
+    return out + length;
+}
+
+// Status line già pronte: finiscono nell'iovec senza essere copiate
+static const char* status_line(http_status_t status) {
+    switch (status) {
+        case HTTP_OK: return "HTTP/1.1 200 OK\r\n";
+        case HTTP_CREATED: return "HTTP/1.1 201 Created\r\n";
+        case HTTP_NO_CONTENT: return "HTTP/1.1 204 No Content\r\n";
+        case HTTP_NOT_MODIFIED: return "HTTP/1.1 304 Not Modified\r\n";
+        case HTTP_BAD_REQUEST: return "HTTP/1.1 400 Bad Request\r\n";
+        case HTTP_NOT_FOUND: return "HTTP/1.1 404 Not Found\r\n";
+        case HTTP_METHOD_NOT_ALLOWED: return "HTTP/1.1 405 Method Not Allowed\r\n";
+        case HTTP_INTERNAL_SERVER_ERROR: return "HTTP/1.1 500 Internal Server Error\r\n";
+        case HTTP_SERVICE_UNAVAILABLE: return "HTTP/1.1 503 Service Unavailable\r\n";
+        default: return NULL;
+    }
+}
+
+// Prepara l'iovec della risposta: status line, headers serializzati in head
+// (dimensione calcolata prima, buffer riusato dal pool se basta) e body, che
+// resta nell'arena o in body_ref. Nessuna concatenazione con il body.
+int build_response(http_response_t *response) {
+    if (!response || response->status_code < 100 || response->status_code > 999) {
         return -1;
     }
-    
-    // Aggiungi gli headers
+
+    static const char server_header[] = "Server: HTTP-Parser/1.0\r\n";
+    static const char keep_alive_header[] = "Connection: keep-alive\r\n";
+    static const char close_header[] = "Connection: close\r\n";
+
+    bool add_date = !response->known_headers[HTTP_HEADER_DATE];
+    bool add_server = !response->known_headers[HTTP_HEADER_SERVER];
+    const char *connection = NULL;
+    size_t connection_length = 0;
+    if (response->keep_alive >= 0 && !response->known_headers[HTTP_HEADER_CONNECTION]) {
+        connection = response->keep_alive ? keep_alive_header : close_header;
+        connection_length = response->keep_alive ? sizeof(keep_alive_header) - 1 : sizeof(close_header) - 1;
+    }
+
+    // 1xx, 204 e 304 non hanno mai un body (RFC 9110, 6.4.1): un body o un
+    // Content-Length verrebbero letti dal client come inizio della risposta
+    // successiva sulla stessa connessione
+    int code = response->status_code;
+    bool has_body = code >= 200 && code != HTTP_NO_CONTENT && code != HTTP_NOT_MODIFIED;
+    const http_prebuilt_body_t *prebuilt = has_body ? response->prebuilt : NULL;
+
+    // Con un body precostruito i suoi header sostituiscono quelli nella lista
+    int skip_length = -1, skip_type = -1;
+    if (response->prebuilt) {
+        skip_length = response->known_headers[HTTP_HEADER_CONTENT_LENGTH] - 1;
+        skip_type = response->known_headers[HTTP_HEADER_CONTENT_TYPE] - 1;
+    } else if (!has_body) {
+        skip_length = response->known_headers[HTTP_HEADER_CONTENT_LENGTH] - 1;
+    }
+
+    const char *line = status_line(response->status_code);
+    size_t message_length = strlen(response->status_message);
+    size_t size = line ? 0 : sizeof("HTTP/1.1 000 ") - 1 + message_length + 2;
+    size += add_date ? sizeof("Date: \r\n") - 1 + HTTP_DATE_LENGTH : 0;
+    size += add_server ? sizeof(server_header) - 1 : 0;
     for (int i = 0; i < response->header_count; i++) {
-        int header_written = snprintf(response->raw_response + written,
-                                     MAX_RESPONSE_SIZE - written,
-                                     "%s: %s\r\n",
-                                     response->headers[i].name,
-                                     response->headers[i].value);
-        
-        if (header_written >= (MAX_RESPONSE_SIZE - written)) {
-            free(response->raw_response);
-            response->raw_response = NULL;
+        if (i != skip_length && i != skip_type) {
+            size += response->headers[i].name_length + 2 + response->headers[i].value_length + 2;
+        }
+    }
+    size += prebuilt ? prebuilt->headers_length : 0;
+    size += connection_length + 2;
+
+    if (size > response->head_capacity) {
+        char *head = realloc(response->head, size);
+        if (!head) {
             return -1;
         }
-        
-        written += header_written;
+        response->head = head;
+        response->head_capacity = size;
     }
-    
-    // Aggiungi la linea vuota
-    if (written + 2 >= MAX_RESPONSE_SIZE) {
-        free(response->raw_response);
-        response->raw_response = NULL;
-        return -1;
+
+    char *out = response->head;
+    if (!line) {
+        // Status line fuori tabella: va in testa agli headers
+        out = append_bytes(out, "HTTP/1.1 ", 9);
+        *out++ = (char)('0' + code / 100);
+        *out++ = (char)('0' + code / 10 % 10);
+        *out++ = (char)('0' + code % 10);
+        *out++ = ' ';
+        out = append_bytes(out, response->status_message, message_length);
+        out = append_bytes(out, "\r\n", 2);
     }
-    
-    strcat(response->raw_response + written, "\r\n");
-    written += 2;
-    
-    // Aggiungi il body se presente
-    if (response->body && response->body_length > 0) {
-        if (written + response->body_length >= MAX_RESPONSE_SIZE) {
-            free(response->raw_response);
-            response->raw_response = NULL;
-            return -1;
+
+    if (add_date) {
+        out = append_bytes(out, "Date: ", 6);
+        out = append_bytes(out, http_date(), HTTP_DATE_LENGTH);
+        out = append_bytes(out, "\r\n", 2);
+    }
+    if (add_server) {
+        out = append_bytes(out, server_header, sizeof(server_header) - 1);
+    }
+
+    // Aggiungi gli headers e la linea vuota
+    for (int i = 0; i < response->header_count; i++) {
+        if (i == skip_length || i == skip_type) {
+            continue;
         }
-        
-        memcpy(response->raw_response + written, response->body, response->body_length);
-        written += response->body_length;
+        const http_response_header_t *header = &response->headers[i];
+        out = append_bytes(out, response->arena + header->name, header->name_length);
+        out = append_bytes(out, ": ", 2);
+        out = append_bytes(out, response->arena + header->value, header->value_length);
+        out = append_bytes(out, "\r\n", 2);
     }
-    
-    response->raw_response_size = written;
+    if (prebuilt) {
+        out = append_bytes(out, prebuilt->headers, prebuilt->headers_length);
+    }
+    if (connection) {
+        out = append_bytes(out, connection, connection_length);
+    }
+    out = append_bytes(out, "\r\n", 2);
+
+    int count = 0;
+    if (line) {
+        response->iov[count].iov_base = (void *)line;
+        response->iov[count].iov_len = strlen(line);
+        count++;
+    }
+    response->iov[count].iov_base = response->head;
+    response->iov[count].iov_len = out - response->head;
+    count++;
+
+    if (has_body && response->body_length > 0) {
+        response->iov[count].iov_base = (void *)http_response_body(response);
+        response->iov[count].iov_len = response->body_length;
+        count++;
+    }
+
+    response->iov_count = count;
+    response->response_size = 0;
+    for (int i = 0; i < count; i++) {
+        response->response_size += response->iov[i].iov_len;
+    }
+
     return 0;
 }
 
-const char* get_response_string(http_response_t *response) {
-    if (!response) {
-        return NULL;
-    }
-    
-    if (!response->raw_response) {
-        if (build_response(response) != 0) {
-            return NULL;
+// Copia in iov (al massimo max_iov voci) la parte della risposta che segue i
+// primi offset byte già inviati; ritorna il numero di voci
+int http_response_iov(const http_response_t *response, size_t offset, struct iovec *iov, int max_iov) {
+    int count = 0;
+
+    for (int i = 0; i < response->iov_count && count < max_iov; i++) {
+        size_t length = response->iov[i].iov_len;
+        if (offset >= length) {
+            offset -= length;
+            continue;
         }
+
+        iov[count].iov_base = (char *)response->iov[i].iov_base + offset;
+        iov[count].iov_len = length - offset;
+        offset = 0;
+        count++;
     }
-    
-    return response->raw_response;
+
+    return count;
 }
 
 void print_http_response(const http_response_t *response) {
@@ -586,21 +1370,22 @@ void print_http_response(const http_response_t *response) {
         printf("Response is NULL\n");
         return;
     }
-    
+
     printf("=== HTTP RESPONSE ===\n");
-    printf("Version: %s\n", response->version);
+    printf("Version: HTTP/1.1\n");
     printf("Status: %d %s\n", response->status_code, response->status_message);
-    
+
     printf("\nHeaders (%d):\n", response->header_count);
     for (int i = 0; i < response->header_count; i++) {
-        printf("  %s: %s\n", response->headers[i].name, response->headers[i].value);
+        printf("  %s: %s\n", response->arena + response->headers[i].name,
+               response->arena + response->headers[i].value);
     }
-    
-    if (response->body && response->body_length > 0) {
+
+    if (response->body_length > 0) {
         printf("\nBody (%zu bytes):\n", response->body_length);
-        printf("%.*s\n", (int)response->body_length, response->body);
+        printf("%.*s\n", (int)response->body_length, http_response_body(response));
     }
-    
+
     printf("====================\n");
 }
 
@@ -609,13 +1394,13 @@ const char* get_response_header_value(const http_response_t *response, const cha
     if (!response || !header_name) {
         return NULL;
     }
-    
+
     for (int i = 0; i < response->header_count; i++) {
-        if (strcasecmp(response->headers[i].name, header_name) == 0) {
-            return response->headers[i].value;
+        if (strcasecmp(response->arena + response->headers[i].name, header_name) == 0) {
+            return response->arena + response->headers[i].value;
         }
     }
-    
+
     return NULL;
 }
 
@@ -634,6 +1419,8 @@ const char* status_to_message(http_status_t status) {
         case HTTP_NOT_FOUND: return "Not Found";
         case HTTP_METHOD_NOT_ALLOWED: return "Method Not Allowed";
         case HTTP_CONFLICT: return "Conflict";
+        case HTTP_PAYLOAD_TOO_LARGE: return "Payload Too Large";
+        case HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE: return "Request Header Fields Too Large";
         case HTTP_INTERNAL_SERVER_ERROR: return "Internal Server Error";
         case HTTP_NOT_IMPLEMENTED: return "Not Implemented";
         case HTTP_BAD_GATEWAY: return "Bad Gateway";
@@ -642,10 +1429,33 @@ const char* status_to_message(http_status_t status) {
     }
 }
 
-char* get_current_time_string() {
-    static char time_buffer[64];
+// Data per l'header Date, aggiornata dai reactor al più una volta al secondo.
+// Ogni secondo ha il suo slot: chi legge copia lo slot pubblicato senza lock
+// e uno slot viene riscritto solo HTTP_DATE_SLOTS secondi dopo
+static char http_date_slots[HTTP_DATE_SLOTS][HTTP_DATE_LENGTH + 1];
+static unsigned int http_date_current = 0;
+static time_t http_date_second = 0;
+
+void http_date_refresh(void) {
     time_t now = time(NULL);
-    struct tm *gmt = gmtime(&now);
-    strftime(time_buffer, sizeof(time_buffer), "%a, %d %b %Y %H:%M:%S GMT", gmt);
-    return time_buffer;
-}
\ No newline at end of file
+    time_t last = __atomic_load_n(&http_date_second, __ATOMIC_ACQUIRE);
+
+    // Con più reactor solo uno aggiorna la cache per ogni nuovo secondo
+    if (now <= last ||
+        !__atomic_compare_exchange_n(&http_date_second, &last, now, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    unsigned int slot = (unsigned int)(now % HTTP_DATE_SLOTS);
+    struct tm gmt;
+    gmtime_r(&now, &gmt);
+    strftime(http_date_slots[slot], sizeof(http_date_slots[slot]), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+    __atomic_store_n(&http_date_current, slot, __ATOMIC_RELEASE);
+}
+
+const char* http_date(void) {
+    if (__atomic_load_n(&http_date_second, __ATOMIC_ACQUIRE) == 0) {
+        http_date_refresh();
+    }
+    return http_date_slots[__atomic_load_n(&http_date_current, __ATOMIC_ACQUIRE)];
+}
@@ -0,0 +1,368 @@
+// json_reader.c
+//
+// Lettura di JSON (RFC 8259) in un solo passaggio: i valori vengono decodificati
+// direttamente nei buffer del chiamante, senza copie intermedie del testo.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json_reader.h"
+
+void json_reader_init(json_reader_t *reader, const char *text, size_t length) {
+    reader->start = text;
+    reader->p = text;
+    reader->end = text + length;
+    reader->error = NULL;
+    reader->error_position = 0;
+}
+
+// Registra il primo errore alla posizione corrente; ritorna sempre false
+bool json_reader_fail(json_reader_t *reader, const char *message) {
+    if (!reader->error) {
+        reader->error = message;
+        reader->error_position = reader->p - reader->start;
+    }
+    return false;
+}
+
+static void skip_whitespace(json_reader_t *reader) {
+    while (reader->p < reader->end &&
+           (*reader->p == ' ' || *reader->p == '\t' || *reader->p == '\n' || *reader->p == '\r')) {
+        reader->p++;
+    }
+}
+
+// Prossimo carattere significativo, '\0' a fine testo o dopo un errore
+char json_peek(json_reader_t *reader) {
+    if (reader->error) {
+        return '\0';
+    }
+    skip_whitespace(reader);
+    return reader->p < reader->end ? *reader->p : '\0';
+}
+
+bool json_expect(json_reader_t *reader, char c) {
+    if (json_peek(reader) != c) {
+        return json_reader_fail(reader, c == '{' ? "atteso un oggetto" : "carattere inatteso");
+    }
+    reader->p++;
+    return true;
+}
+
+// Avanza al prossimo membro di un oggetto già aperto con '{'. Ritorna false
+// alla '}' finale (consumata) o in caso di errore (reader->error impostato)
+bool json_object_next(json_reader_t *reader, bool *first) {
+    char c = json_peek(reader);
+    if (reader->error) {
+        return false;
+    }
+
+    if (c == '}') {
+        reader->p++;
+        return false;
+    }
+
+    if (!*first && !json_expect(reader, ',')) {
+        return false;
+    }
+
+    *first = false;
+    return true;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool read_hex4(json_reader_t *reader, unsigned int *value) {
+    if (reader->end - reader->p < 4) {
+        return json_reader_fail(reader, "escape \\u incompleto");
+    }
+
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_value(reader->p[i]);
+        if (digit < 0) {
+            return json_reader_fail(reader, "escape \\u non valido");
+        }
+        *value = (*value << 4) | (unsigned int)digit;
+    }
+
+    reader->p += 4;
+    return true;
+}
+
+// Scrive c in out se c'è posto (lasciando spazio per il '\0'); la lunghezza
+// conta comunque tutti i byte, così il chiamante riconosce il troncamento
+static void put_byte(char *out, size_t size, size_t *length, char c) {
+    if (out && *length + 1 < size) {
+        out[*length] = c;
+    }
+    (*length)++;
+}
+
+static void put_utf8(char *out, size_t size, size_t *length, unsigned int code) {
+    if (code < 0x80) {
+        put_byte(out, size, length, (char)code);
+    } else if (code < 0x800) {
+        put_byte(out, size, length, (char)(0xC0 | (code >> 6)));
+        put_byte(out, size, length, (char)(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        put_byte(out, size, length, (char)(0xE0 | (code >> 12)));
+        put_byte(out, size, length, (char)(0x80 | ((code >> 6) & 0x3F)));
+        put_byte(out, size, length, (char)(0x80 | (code & 0x3F)));
+    } else {
+        put_byte(out, size, length, (char)(0xF0 | (code >> 18)));
+        put_byte(out, size, length, (char)(0x80 | ((code >> 12) & 0x3F)));
+        put_byte(out, size, length, (char)(0x80 | ((code >> 6) & 0x3F)));
+        put_byte(out, size, length, (char)(0x80 | (code & 0x3F)));
+    }
+}
+
+static bool read_escape(json_reader_t *reader, char *out, size_t size, size_t *length) {
+    if (reader->p >= reader->end) {
+        return json_reader_fail(reader, "stringa non terminata");
+    }
+
+    char c = *reader->p++;
+    switch (c) {
+        case '"': case '\\': case '/': put_byte(out, size, length, c); return true;
+        case 'b': put_byte(out, size, length, '\b'); return true;
+        case 'f': put_byte(out, size, length, '\f'); return true;
+        case 'n': put_byte(out, size, length, '\n'); return true;
+        case 'r': put_byte(out, size, length, '\r'); return true;
+        case 't': put_byte(out, size, length, '\t'); return true;
+        case 'u': break;
+        default:
+            reader->p--;
+            return json_reader_fail(reader, "escape non valido");
+    }
+
+    unsigned int code;
+    if (!read_hex4(reader, &code)) {
+        return false;
+    }
+
+    // I caratteri fuori dal BMP arrivano come coppia di surrogati
+    if (code >= 0xD800 && code <= 0xDBFF) {
+        unsigned int low;
+        if (reader->end - reader->p < 2 || reader->p[0] != '\\' || reader->p[1] != 'u') {
+            return json_reader_fail(reader, "surrogato senza coppia");
+        }
+        reader->p += 2;
+        if (!read_hex4(reader, &low)) {
+            return false;
+        }
+        if (low < 0xDC00 || low > 0xDFFF) {
+            return json_reader_fail(reader, "surrogato senza coppia");
+        }
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    } else if (code >= 0xDC00 && code <= 0xDFFF) {
+        return json_reader_fail(reader, "surrogato senza coppia");
+    }
+
+    put_utf8(out, size, length, code);
+    return true;
+}
+
+// Decodifica una stringa in out (se non NULL), sempre terminata da '\0'.
+// *length è la lunghezza decodificata completa, anche se out era troppo piccolo
+static bool read_string(json_reader_t *reader, char *out, size_t size, size_t *length) {
+    if (json_peek(reader) != '"') {
+        return json_reader_fail(reader, "attesa una stringa");
+    }
+    reader->p++;
+
+    *length = 0;
+    while (reader->p < reader->end) {
+        // Tratto senza escape: copiato in blocco
+        const char *run = reader->p;
+        while (reader->p < reader->end && *reader->p != '"' && *reader->p != '\\' &&
+               (unsigned char)*reader->p >= 0x20) {
+            reader->p++;
+        }
+
+        size_t run_length = reader->p - run;
+        if (out && *length + 1 < size) {
+            size_t room = size - 1 - *length;
+            memcpy(out + *length, run, run_length < room ? run_length : room);
+        }
+        *length += run_length;
+
+        if (reader->p >= reader->end) {
+            break;
+        }
+
+        char c = *reader->p;
+        if (c == '"') {
+            reader->p++;
+            if (out && size > 0) {
+                out[*length < size ? *length : size - 1] = '\0';
+            }
+            return true;
+        }
+        if (c != '\\') {
+            return json_reader_fail(reader, "carattere di controllo in una stringa");
+        }
+
+        reader->p++;
+        if (!read_escape(reader, out, size, length)) {
+            return false;
+        }
+    }
+
+    return json_reader_fail(reader, "stringa non terminata");
+}
+
+// Chiave di un membro e ':' che la segue. Una chiave più lunga di size viene
+// troncata senza errore: *length >= size la distingue da ogni chiave nota
+bool json_read_key(json_reader_t *reader, char *key, size_t size, size_t *length) {
+    return read_string(reader, key, size, length) && json_expect(reader, ':');
+}
+
+// Valore stringa: se non entra in out (terminatore compreso) è un errore
+bool json_read_string(json_reader_t *reader, char *out, size_t size, size_t *length) {
+    const char *value_start = reader->p;
+    size_t decoded;
+
+    if (!read_string(reader, out, size, &decoded)) {
+        return false;
+    }
+
+    if (decoded >= size) {
+        reader->p = value_start;
+        skip_whitespace(reader);
+        return json_reader_fail(reader, "stringa troppo lunga");
+    }
+
+    if (length) {
+        *length = decoded;
+    }
+    return true;
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Numero secondo la grammatica JSON, convertito con strtod su una copia in stack
+bool json_read_number(json_reader_t *reader, double *value) {
+    json_peek(reader);
+    if (reader->error) {
+        return false;
+    }
+
+    const char *number = reader->p;
+    const char *p = reader->p;
+    const char *end = reader->end;
+
+    if (p < end && *p == '-') p++;
+    if (p < end && *p == '0') {
+        p++;
+    } else if (p < end && is_digit(*p)) {
+        while (p < end && is_digit(*p)) p++;
+    } else {
+        return json_reader_fail(reader, "atteso un numero");
+    }
+
+    if (p < end && *p == '.') {
+        p++;
+        if (p >= end || !is_digit(*p)) {
+            reader->p = p;
+            return json_reader_fail(reader, "numero non valido");
+        }
+        while (p < end && is_digit(*p)) p++;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        if (p >= end || !is_digit(*p)) {
+            reader->p = p;
+            return json_reader_fail(reader, "numero non valido");
+        }
+        while (p < end && is_digit(*p)) p++;
+    }
+
+    size_t length = p - number;
+    if (length >= JSON_MAX_NUMBER_LEN) {
+        return json_reader_fail(reader, "numero troppo lungo");
+    }
+
+    char digits[JSON_MAX_NUMBER_LEN];
+    memcpy(digits, number, length);
+    digits[length] = '\0';
+
+    *value = strtod(digits, NULL);
+    reader->p = p;
+    return true;
+}
+
+static bool skip_literal(json_reader_t *reader, const char *literal) {
+    size_t length = strlen(literal);
+    if ((size_t)(reader->end - reader->p) < length || memcmp(reader->p, literal, length) != 0) {
+        return json_reader_fail(reader, "valore non valido");
+    }
+    reader->p += length;
+    return true;
+}
+
+static bool skip_value(json_reader_t *reader, int depth) {
+    if (depth > JSON_MAX_DEPTH) {
+        return json_reader_fail(reader, "annidamento eccessivo");
+    }
+
+    size_t length;
+    double number;
+    bool first = true;
+
+    switch (json_peek(reader)) {
+        case '"':
+            return read_string(reader, NULL, 0, &length);
+        case '{':
+            reader->p++;
+            while (json_object_next(reader, &first)) {
+                if (!read_string(reader, NULL, 0, &length) || !json_expect(reader, ':') ||
+                    !skip_value(reader, depth + 1)) {
+                    return false;
+                }
+            }
+            return reader->error == NULL;
+        case '[':
+            reader->p++;
+            if (json_peek(reader) == ']') {
+                reader->p++;
+                return true;
+            }
+            do {
+                if (!skip_value(reader, depth + 1)) {
+                    return false;
+                }
+            } while (json_peek(reader) == ',' && reader->p++);
+            return json_expect(reader, ']');
+        case 't':
+            return skip_literal(reader, "true");
+        case 'f':
+            return skip_literal(reader, "false");
+        case 'n':
+            return skip_literal(reader, "null");
+        default:
+            return json_read_number(reader, &number);
+    }
+}
+
+// Salta un valore qualsiasi (es. il valore di una chiave sconosciuta)
+bool json_skip_value(json_reader_t *reader) {
+    return skip_value(reader, 0);
+}
+
+// Dopo il valore principale è ammesso solo whitespace
+bool json_expect_end(json_reader_t *reader) {
+    if (json_peek(reader) != '\0' || reader->p != reader->end) {
+        return reader->error ? false : json_reader_fail(reader, "contenuto dopo la fine del JSON");
+    }
+    return true;
+}
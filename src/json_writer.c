@@ -0,0 +1,325 @@
+// json_writer.c
+//
+// Scrittura di JSON (RFC 8259) direttamente nell'arena della risposta: ogni
+// valore riserva il caso peggiore, scrive in place e conferma i byte usati.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json_writer.h"
+
+#define JSON_CONTENT_TYPE "application/json; charset=utf-8"
+
+// Escape di ogni byte in una stringa: 0 = copiato così com'è, 'u' = \u00XX,
+// altrimenti il carattere che segue il backslash
+static const char escape_table[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0,   0,   '"', 0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   '\\', 0,  0,   0,
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
+// Coppie di cifre "00".."99": dimezza le divisioni nella conversione degli interi
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+void json_writer_init(json_writer_t *writer, http_response_t *response) {
+    writer->response = response;
+    writer->has_items = 0;
+    writer->depth = 0;
+    writer->after_key = false;
+    writer->failed = false;
+    http_response_body_begin(response);
+}
+
+// Chiude il body e imposta Content-Length e Content-Type
+int json_writer_finish(json_writer_t *writer) {
+    if (writer->failed || writer->depth != 0) {
+        return -1;
+    }
+    return http_response_body_end(writer->response, JSON_CONTENT_TYPE);
+}
+
+static char* writer_reserve(json_writer_t *writer, size_t length) {
+    char *out = http_response_body_reserve(writer->response, length);
+    if (!out) {
+        writer->failed = true;
+    }
+    return out;
+}
+
+static void writer_commit(json_writer_t *writer, size_t length) {
+    http_response_body_commit(writer->response, length);
+}
+
+// Separatore prima di un valore: virgola se il livello ne contiene già uno
+static bool begin_value(json_writer_t *writer) {
+    if (writer->failed) {
+        return false;
+    }
+
+    if (writer->after_key) {
+        writer->after_key = false;
+        return true;
+    }
+
+    if (writer->depth > 0) {
+        uint32_t bit = 1u << (writer->depth - 1);
+        if (writer->has_items & bit) {
+            char *out = writer_reserve(writer, 1);
+            if (!out) {
+                return false;
+            }
+            *out = ',';
+            writer_commit(writer, 1);
+        } else {
+            writer->has_items |= bit;
+        }
+    }
+
+    return true;
+}
+
+static void put_raw(json_writer_t *writer, const char *data, size_t length) {
+    char *out = writer_reserve(writer, length);
+    if (out) {
+        memcpy(out, data, length);
+        writer_commit(writer, length);
+    }
+}
+
+static void begin_container(json_writer_t *writer, char open) {
+    if (!begin_value(writer)) {
+        return;
+    }
+    if (writer->depth >= JSON_WRITER_MAX_DEPTH) {
+        writer->failed = true;
+        return;
+    }
+
+    writer->depth++;
+    writer->has_items &= ~(1u << (writer->depth - 1));
+    put_raw(writer, &open, 1);
+}
+
+static void end_container(json_writer_t *writer, char close) {
+    if (writer->failed) {
+        return;
+    }
+    if (writer->depth == 0 || writer->after_key) {
+        writer->failed = true;
+        return;
+    }
+
+    writer->depth--;
+    put_raw(writer, &close, 1);
+}
+
+void json_begin_object(json_writer_t *writer) {
+    begin_container(writer, '{');
+}
+
+void json_end_object(json_writer_t *writer) {
+    end_container(writer, '}');
+}
+
+void json_begin_array(json_writer_t *writer) {
+    begin_container(writer, '[');
+}
+
+void json_end_array(json_writer_t *writer) {
+    end_container(writer, ']');
+}
+
+// Stringa tra virgolette con escape; i byte UTF-8 passano invariati
+static void write_string(json_writer_t *writer, const char *value, size_t length) {
+    if (length > (UINT32_MAX - 2) / 6) {
+        writer->failed = true;
+        return;
+    }
+
+    char *out = writer_reserve(writer, length * 6 + 2);
+    if (!out) {
+        return;
+    }
+
+    char *p = out;
+    *p++ = '"';
+
+    const unsigned char *s = (const unsigned char *)value;
+    const unsigned char *end = s + length;
+    while (s < end) {
+        // Tratto senza escape: copiato in blocco
+        const unsigned char *run = s;
+        while (s < end && !escape_table[*s]) {
+            s++;
+        }
+        memcpy(p, run, s - run);
+        p += s - run;
+
+        if (s == end) {
+            break;
+        }
+
+        char escape = escape_table[*s];
+        *p++ = '\\';
+        *p++ = escape;
+        if (escape == 'u') {
+            *p++ = '0';
+            *p++ = '0';
+            *p++ = hex_digits[*s >> 4];
+            *p++ = hex_digits[*s & 0x0F];
+        }
+        s++;
+    }
+
+    *p++ = '"';
+    writer_commit(writer, p - out);
+}
+
+void json_key(json_writer_t *writer, const char *key) {
+    if (writer->after_key) {
+        writer->failed = true;
+    }
+    if (!begin_value(writer)) {
+        return;
+    }
+
+    write_string(writer, key, strlen(key));
+    put_raw(writer, ":", 1);
+    writer->after_key = true;
+}
+
+void json_string(json_writer_t *writer, const char *value, size_t length) {
+    if (begin_value(writer)) {
+        write_string(writer, value, length);
+    }
+}
+
+void json_cstring(json_writer_t *writer, const char *value) {
+    if (!value) {
+        json_null(writer);
+        return;
+    }
+    json_string(writer, value, strlen(value));
+}
+
+// Cifre decimali di value in out, senza terminatore; ritorna quante sono
+static int format_uint(char *out, unsigned long long value) {
+    char digits[20];
+    int i = sizeof(digits);
+
+    while (value >= 100) {
+        unsigned int pair = (unsigned int)(value % 100) * 2;
+        value /= 100;
+        digits[--i] = digit_pairs[pair + 1];
+        digits[--i] = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        unsigned int pair = (unsigned int)value * 2;
+        digits[--i] = digit_pairs[pair + 1];
+        digits[--i] = digit_pairs[pair];
+    } else {
+        digits[--i] = (char)('0' + value);
+    }
+
+    int length = sizeof(digits) - i;
+    memcpy(out, digits + i, length);
+    return length;
+}
+
+void json_int(json_writer_t *writer, long long value) {
+    if (!begin_value(writer)) {
+        return;
+    }
+
+    char *out = writer_reserve(writer, 21);
+    if (!out) {
+        return;
+    }
+
+    int length = 0;
+    unsigned long long magnitude = (unsigned long long)value;
+    if (value < 0) {
+        out[length++] = '-';
+        magnitude = 0 - magnitude;
+    }
+    length += format_uint(out + length, magnitude);
+    writer_commit(writer, length);
+}
+
+// La rappresentazione più corta che, riletta con strtod, ridà esattamente
+// value. Senza terminatore; NaN e infiniti non esistono in JSON: "null"
+int json_format_double(char *out, double value) {
+    if (!isfinite(value)) {
+        memcpy(out, "null", 4);
+        return 4;
+    }
+
+    // Percorso veloce per i valori con al più due decimali (i prezzi): se
+    // cents / 100 ridà value, il decimale "intero.cc" è la sua forma più corta
+    if (fabs(value) < 1e13 && !(value == 0 && signbit(value))) {
+        long long cents = llround(value * 100.0);
+        if ((double)cents / 100.0 == value) {
+            int length = 0;
+            unsigned long long magnitude = (unsigned long long)(cents < 0 ? -cents : cents);
+            if (cents < 0) {
+                out[length++] = '-';
+            }
+            length += format_uint(out + length, magnitude / 100);
+
+            unsigned int fraction = (unsigned int)(magnitude % 100);
+            if (fraction) {
+                out[length++] = '.';
+                out[length++] = (char)('0' + fraction / 10);
+                if (fraction % 10) {
+                    out[length++] = (char)('0' + fraction % 10);
+                }
+            }
+            return length;
+        }
+    }
+
+    // 17 cifre significative bastano sempre; spesso ne bastano 15 o 16
+    char buffer[JSON_DOUBLE_MAX_LEN];
+    int length = 0;
+    for (int precision = 15; precision <= 17; precision++) {
+        length = snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        if (precision == 17 || strtod(buffer, NULL) == value) {
+            break;
+        }
+    }
+
+    memcpy(out, buffer, length);
+    return length;
+}
+
+void json_double(json_writer_t *writer, double value) {
+    if (!begin_value(writer)) {
+        return;
+    }
+
+    char *out = writer_reserve(writer, JSON_DOUBLE_MAX_LEN);
+    if (out) {
+        writer_commit(writer, json_format_double(out, value));
+    }
+}
+
+void json_bool(json_writer_t *writer, bool value) {
+    if (begin_value(writer)) {
+        put_raw(writer, value ? "true" : "false", value ? 4 : 5);
+    }
+}
+
+void json_null(json_writer_t *writer) {
+    if (begin_value(writer)) {
+        put_raw(writer, "null", 4);
+    }
+}
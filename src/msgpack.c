@@ -0,0 +1,460 @@
+// msgpack.c
+//
+// Lettura e scrittura di MessagePack (https://msgpack.org/): il lettore
+// lavora sul buffer ricevuto senza copiarlo, lo scrittore accoda
+// direttamente al body della risposta, come json_reader e json_writer.
+
+#include <math.h>
+#include <string.h>
+#include "msgpack.h"
+
+void msgpack_reader_init(msgpack_reader_t *reader, const char *data, size_t length) {
+    reader->start = (const unsigned char *)data;
+    reader->p = reader->start;
+    reader->end = reader->start + length;
+    reader->error = NULL;
+    reader->error_position = 0;
+}
+
+// Registra il primo errore alla posizione corrente; ritorna sempre false
+bool msgpack_reader_fail(msgpack_reader_t *reader, const char *message) {
+    if (!reader->error) {
+        reader->error = message;
+        reader->error_position = reader->p - reader->start;
+    }
+    return false;
+}
+
+static bool need(msgpack_reader_t *reader, size_t length) {
+    if (reader->error) {
+        return false;
+    }
+    if ((size_t)(reader->end - reader->p) < length) {
+        return msgpack_reader_fail(reader, "dati troncati");
+    }
+    return true;
+}
+
+static uint64_t load_be(const unsigned char *p, int size) {
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+// Lunghezza big-endian di size byte dopo il byte di tipo (già consumato)
+static bool read_length(msgpack_reader_t *reader, int size, uint32_t *length) {
+    if (!need(reader, size)) {
+        return false;
+    }
+    *length = (uint32_t)load_be(reader->p, size);
+    reader->p += size;
+    return true;
+}
+
+bool msgpack_read_map(msgpack_reader_t *reader, uint32_t *count) {
+    if (!need(reader, 1)) {
+        return false;
+    }
+
+    unsigned char type = *reader->p;
+    if ((type & 0xF0) == 0x80) {
+        reader->p++;
+        *count = type & 0x0F;
+        return true;
+    }
+    if (type != 0xde && type != 0xdf) {
+        return msgpack_reader_fail(reader, "attesa una mappa");
+    }
+
+    reader->p++;
+    return read_length(reader, type == 0xde ? 2 : 4, count);
+}
+
+bool msgpack_read_array(msgpack_reader_t *reader, uint32_t *count) {
+    if (!need(reader, 1)) {
+        return false;
+    }
+
+    unsigned char type = *reader->p;
+    if ((type & 0xF0) == 0x90) {
+        reader->p++;
+        *count = type & 0x0F;
+        return true;
+    }
+    if (type != 0xdc && type != 0xdd) {
+        return msgpack_reader_fail(reader, "atteso un array");
+    }
+
+    reader->p++;
+    return read_length(reader, type == 0xdc ? 2 : 4, count);
+}
+
+// Stringa UTF-8: *data punta dentro l'input e non è terminata da '\0'
+bool msgpack_read_str(msgpack_reader_t *reader, const char **data, uint32_t *length) {
+    if (!need(reader, 1)) {
+        return false;
+    }
+
+    unsigned char type = *reader->p;
+    if ((type & 0xE0) == 0xA0) {
+        reader->p++;
+        *length = type & 0x1F;
+    } else if (type >= 0xd9 && type <= 0xdb) {
+        reader->p++;
+        if (!read_length(reader, 1 << (type - 0xd9), length)) {
+            return false;
+        }
+    } else {
+        return msgpack_reader_fail(reader, "attesa una stringa");
+    }
+
+    if (!need(reader, *length)) {
+        return false;
+    }
+
+    *data = (const char *)reader->p;
+    reader->p += *length;
+    return true;
+}
+
+bool msgpack_read_int(msgpack_reader_t *reader, int64_t *value) {
+    if (!need(reader, 1)) {
+        return false;
+    }
+
+    unsigned char type = *reader->p;
+    if (type <= 0x7f) {
+        reader->p++;
+        *value = type;
+        return true;
+    }
+    if (type >= 0xe0) {
+        reader->p++;
+        *value = (int8_t)type;
+        return true;
+    }
+
+    // uint 8..64 (0xcc-0xcf) e int 8..64 (0xd0-0xd3)
+    bool is_unsigned = type >= 0xcc && type <= 0xcf;
+    if (!is_unsigned && !(type >= 0xd0 && type <= 0xd3)) {
+        return msgpack_reader_fail(reader, "atteso un intero");
+    }
+
+    int size = 1 << (type - (is_unsigned ? 0xcc : 0xd0));
+    if (!need(reader, 1 + size)) {
+        return false;
+    }
+
+    uint64_t bits = load_be(reader->p + 1, size);
+    if (is_unsigned) {
+        if (bits > INT64_MAX) {
+            return msgpack_reader_fail(reader, "intero fuori intervallo");
+        }
+        *value = (int64_t)bits;
+    } else {
+        // Estensione del segno dalla larghezza originale
+        int shift = 64 - size * 8;
+        *value = (int64_t)(bits << shift) >> shift;
+    }
+
+    reader->p += 1 + size;
+    return true;
+}
+
+// Numero qualsiasi: interi e float 32/64 bit
+bool msgpack_read_number(msgpack_reader_t *reader, double *value) {
+    if (!need(reader, 1)) {
+        return false;
+    }
+
+    unsigned char type = *reader->p;
+    if (type == 0xca) {
+        if (!need(reader, 5)) {
+            return false;
+        }
+        uint32_t bits = (uint32_t)load_be(reader->p + 1, 4);
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        *value = f;
+        reader->p += 5;
+        return true;
+    }
+    if (type == 0xcb) {
+        if (!need(reader, 9)) {
+            return false;
+        }
+        uint64_t bits = load_be(reader->p + 1, 8);
+        memcpy(value, &bits, sizeof(*value));
+        reader->p += 9;
+        return true;
+    }
+    if (type == 0xcf) {
+        if (!need(reader, 9)) {
+            return false;
+        }
+        *value = (double)load_be(reader->p + 1, 8);
+        reader->p += 9;
+        return true;
+    }
+
+    if (!(type <= 0x7f || type >= 0xe0 || (type >= 0xcc && type <= 0xd3))) {
+        return msgpack_reader_fail(reader, "atteso un numero");
+    }
+
+    int64_t integer;
+    if (!msgpack_read_int(reader, &integer)) {
+        return false;
+    }
+    *value = (double)integer;
+    return true;
+}
+
+static bool skip_bytes(msgpack_reader_t *reader, size_t length) {
+    if (!need(reader, length)) {
+        return false;
+    }
+    reader->p += length;
+    return true;
+}
+
+static bool skip_value(msgpack_reader_t *reader, int depth);
+
+// Salta count valori; ognuno occupa almeno un byte, così un conteggio
+// assurdo viene scartato subito invece di scorrere miliardi di elementi
+static bool skip_values(msgpack_reader_t *reader, uint64_t count, int depth) {
+    if (count > (uint64_t)(reader->end - reader->p)) {
+        return msgpack_reader_fail(reader, "dati troncati");
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        if (!skip_value(reader, depth)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool skip_value(msgpack_reader_t *reader, int depth) {
+    if (depth > MSGPACK_MAX_DEPTH) {
+        return msgpack_reader_fail(reader, "annidamento eccessivo");
+    }
+    if (!need(reader, 1)) {
+        return false;
+    }
+
+    unsigned char type = *reader->p;
+    uint32_t length;
+
+    if (type <= 0x7f || type >= 0xe0 || type == 0xc0 || type == 0xc2 || type == 0xc3) {
+        reader->p++;
+        return true;
+    }
+    if ((type & 0xF0) == 0x80 || type == 0xde || type == 0xdf) {
+        return msgpack_read_map(reader, &length) && skip_values(reader, (uint64_t)length * 2, depth + 1);
+    }
+    if ((type & 0xF0) == 0x90 || type == 0xdc || type == 0xdd) {
+        return msgpack_read_array(reader, &length) && skip_values(reader, length, depth + 1);
+    }
+    if ((type & 0xE0) == 0xA0) {
+        reader->p++;
+        return skip_bytes(reader, type & 0x1F);
+    }
+
+    reader->p++;
+    switch (type) {
+        case 0xc4: case 0xc5: case 0xc6:        // bin 8/16/32
+            return read_length(reader, 1 << (type - 0xc4), &length) && skip_bytes(reader, length);
+        case 0xd9: case 0xda: case 0xdb:        // str 8/16/32
+            return read_length(reader, 1 << (type - 0xd9), &length) && skip_bytes(reader, length);
+        case 0xc7: case 0xc8: case 0xc9:        // ext 8/16/32: lunghezza, tipo, dati
+            return read_length(reader, 1 << (type - 0xc7), &length) && skip_bytes(reader, (size_t)length + 1);
+        case 0xca: return skip_bytes(reader, 4);
+        case 0xcb: return skip_bytes(reader, 8);
+        case 0xcc: case 0xcd: case 0xce: case 0xcf:
+            return skip_bytes(reader, 1 << (type - 0xcc));
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3:
+            return skip_bytes(reader, 1 << (type - 0xd0));
+        case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:  // fixext 1..16
+            return skip_bytes(reader, 1 + (1 << (type - 0xd4)));
+        default:
+            reader->p--;
+            return msgpack_reader_fail(reader, "tipo non valido");
+    }
+}
+
+// Salta un valore qualsiasi (es. il valore di una chiave sconosciuta)
+bool msgpack_skip_value(msgpack_reader_t *reader) {
+    return skip_value(reader, 0);
+}
+
+bool msgpack_expect_end(msgpack_reader_t *reader) {
+    if (reader->error) {
+        return false;
+    }
+    if (reader->p != reader->end) {
+        return msgpack_reader_fail(reader, "dati dopo la fine del valore");
+    }
+    return true;
+}
+
+void msgpack_writer_init(msgpack_writer_t *writer, http_response_t *response) {
+    writer->response = response;
+    writer->failed = false;
+    http_response_body_begin(response);
+}
+
+// Chiude il body e imposta Content-Length e Content-Type
+int msgpack_writer_finish(msgpack_writer_t *writer) {
+    if (writer->failed) {
+        return -1;
+    }
+    return http_response_body_end(writer->response, MSGPACK_CONTENT_TYPE);
+}
+
+static unsigned char* writer_reserve(msgpack_writer_t *writer, size_t length) {
+    if (writer->failed) {
+        return NULL;
+    }
+
+    char *out = http_response_body_reserve(writer->response, length);
+    if (!out) {
+        writer->failed = true;
+    }
+    return (unsigned char *)out;
+}
+
+static void store_be(unsigned char *p, uint64_t value, int size) {
+    for (int i = size - 1; i >= 0; i--) {
+        p[i] = (unsigned char)value;
+        value >>= 8;
+    }
+}
+
+// Byte di tipo seguito da value su size byte big-endian
+static void write_tagged(msgpack_writer_t *writer, unsigned char type, uint64_t value, int size) {
+    unsigned char *out = writer_reserve(writer, 1 + size);
+    if (out) {
+        out[0] = type;
+        store_be(out + 1, value, size);
+        http_response_body_commit(writer->response, 1 + size);
+    }
+}
+
+static void write_byte(msgpack_writer_t *writer, unsigned char byte) {
+    write_tagged(writer, byte, 0, 0);
+}
+
+void msgpack_write_map(msgpack_writer_t *writer, uint32_t count) {
+    if (count < 16) {
+        write_byte(writer, 0x80 | count);
+    } else if (count <= UINT16_MAX) {
+        write_tagged(writer, 0xde, count, 2);
+    } else {
+        write_tagged(writer, 0xdf, count, 4);
+    }
+}
+
+void msgpack_write_array(msgpack_writer_t *writer, uint32_t count) {
+    if (count < 16) {
+        write_byte(writer, 0x90 | count);
+    } else if (count <= UINT16_MAX) {
+        write_tagged(writer, 0xdc, count, 2);
+    } else {
+        write_tagged(writer, 0xdd, count, 4);
+    }
+}
+
+void msgpack_write_str(msgpack_writer_t *writer, const char *data, size_t length) {
+    if (length > UINT32_MAX) {
+        writer->failed = true;
+        return;
+    }
+
+    unsigned char *out = writer_reserve(writer, 5 + length);
+    if (!out) {
+        return;
+    }
+
+    int header;
+    if (length < 32) {
+        out[0] = 0xA0 | (unsigned char)length;
+        header = 1;
+    } else if (length <= UINT8_MAX) {
+        out[0] = 0xd9;
+        header = 2;
+    } else if (length <= UINT16_MAX) {
+        out[0] = 0xda;
+        header = 3;
+    } else {
+        out[0] = 0xdb;
+        header = 5;
+    }
+    store_be(out + 1, length, header - 1);
+    memcpy(out + header, data, length);
+    http_response_body_commit(writer->response, header + length);
+}
+
+void msgpack_write_cstr(msgpack_writer_t *writer, const char *value) {
+    if (!value) {
+        msgpack_write_nil(writer);
+        return;
+    }
+    msgpack_write_str(writer, value, strlen(value));
+}
+
+// Intero nella forma più corta che lo contiene
+void msgpack_write_int(msgpack_writer_t *writer, int64_t value) {
+    if (value >= 0) {
+        if (value <= 0x7f) {
+            write_byte(writer, (unsigned char)value);
+        } else if (value <= UINT8_MAX) {
+            write_tagged(writer, 0xcc, value, 1);
+        } else if (value <= UINT16_MAX) {
+            write_tagged(writer, 0xcd, value, 2);
+        } else if (value <= UINT32_MAX) {
+            write_tagged(writer, 0xce, value, 4);
+        } else {
+            write_tagged(writer, 0xcf, value, 8);
+        }
+    } else if (value >= -32) {
+        write_byte(writer, (unsigned char)(int8_t)value);
+    } else if (value >= INT8_MIN) {
+        write_tagged(writer, 0xd0, (uint8_t)value, 1);
+    } else if (value >= INT16_MIN) {
+        write_tagged(writer, 0xd1, (uint16_t)value, 2);
+    } else if (value >= INT32_MIN) {
+        write_tagged(writer, 0xd2, (uint32_t)value, 4);
+    } else {
+        write_tagged(writer, 0xd3, (uint64_t)value, 8);
+    }
+}
+
+// Come json_double scrive 120 e non 120.0: gli interi esatti diventano
+// interi, i valori esatti in float32 (es. 3.5) usano 5 byte invece di 9
+void msgpack_write_double(msgpack_writer_t *writer, double value) {
+    if (value == floor(value) && fabs(value) < 9007199254740992.0 && !(value == 0 && signbit(value))) {
+        msgpack_write_int(writer, (int64_t)value);
+        return;
+    }
+
+    float narrow = (float)value;
+    if ((double)narrow == value || isnan(value)) {
+        uint32_t bits;
+        memcpy(&bits, &narrow, sizeof(bits));
+        write_tagged(writer, 0xca, bits, 4);
+        return;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    write_tagged(writer, 0xcb, bits, 8);
+}
+
+void msgpack_write_bool(msgpack_writer_t *writer, bool value) {
+    write_byte(writer, value ? 0xc3 : 0xc2);
+}
+
+void msgpack_write_nil(msgpack_writer_t *writer) {
+    write_byte(writer, 0xc0);
+}
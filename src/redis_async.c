@@ -0,0 +1,169 @@
+// redis_async.c
+//
+// Adattatore tra l'API asincrona di hiredis e l'event loop epoll del
+// reactor: hiredis chiede di attivare o togliere lettura e scrittura sul
+// proprio socket, il reactor gli passa gli eventi che ne arrivano.
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include "redis_async.h"
+#include "redis_pool.h"
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Porta la registrazione epoll del socket agli eventi richiesti
+static void update_events(redis_async_t *redis, uint32_t events) {
+    if (events == redis->events || redis->fd < 0) {
+        return;
+    }
+
+    struct epoll_event event = { .events = events, .data.fd = redis->fd };
+    int op = redis->events == 0 ? EPOLL_CTL_ADD : events == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    if (epoll_ctl(redis->epoll_fd, op, redis->fd, &event) < 0) {
+        perror("epoll_ctl: redis");
+        return;
+    }
+    redis->events = events;
+}
+
+static void add_read(void *data) {
+    redis_async_t *redis = data;
+    update_events(redis, redis->events | EPOLLIN);
+}
+
+static void del_read(void *data) {
+    redis_async_t *redis = data;
+    update_events(redis, redis->events & ~EPOLLIN);
+}
+
+static void add_write(void *data) {
+    redis_async_t *redis = data;
+    update_events(redis, redis->events | EPOLLOUT);
+}
+
+static void del_write(void *data) {
+    redis_async_t *redis = data;
+    update_events(redis, redis->events & ~EPOLLOUT);
+}
+
+// hiredis sta per chiudere il socket
+static void cleanup(void *data) {
+    redis_async_t *redis = data;
+    update_events(redis, 0);
+    redis->fd = -1;
+}
+
+// Il contesto è stato (o sta per essere) liberato da hiredis: il prossimo
+// comando ne crea uno nuovo, subito dopo una disconnessione e non prima del
+// backoff dopo una connessione fallita
+static void forget_context(redis_async_t *redis) {
+    redis->context = NULL;
+    redis->connected = false;
+    redis->fd = -1;
+    redis->events = 0;
+}
+
+static void schedule_retry(redis_async_t *redis) {
+    redis->retry_at_ms = now_ms() + redis->backoff_ms;
+    redis->backoff_ms = redis->backoff_ms * 2 < REDIS_BACKOFF_MAX_MS ? redis->backoff_ms * 2 : REDIS_BACKOFF_MAX_MS;
+}
+
+static void on_connect(const redisAsyncContext *context, int status) {
+    redis_async_t *redis = context->data;
+
+    if (status != REDIS_OK) {
+        fprintf(stderr, "Errore connessione Redis asincrona: %s (nuovo tentativo tra %d ms)\n",
+                context->errstr, redis->backoff_ms);
+        forget_context(redis);
+        schedule_retry(redis);
+        return;
+    }
+
+    redis->connected = true;
+    redis->backoff_ms = REDIS_BACKOFF_MIN_MS;
+}
+
+static void on_disconnect(const redisAsyncContext *context, int status) {
+    redis_async_t *redis = context->data;
+
+    if (status != REDIS_OK) {
+        fprintf(stderr, "Connessione Redis asincrona persa: %s\n", context->errstr);
+    }
+    forget_context(redis);
+}
+
+void redis_async_init(redis_async_t *redis, int epoll_fd, const char *host, int port) {
+    redis->context = NULL;
+    redis->epoll_fd = epoll_fd;
+    redis->fd = -1;
+    redis->events = 0;
+    redis->connected = false;
+    redis->retry_at_ms = 0;
+    redis->backoff_ms = REDIS_BACKOFF_MIN_MS;
+    redis->host = host;
+    redis->port = port;
+}
+
+// Le richieste ancora in attesa ricevono una risposta NULL
+void redis_async_destroy(redis_async_t *redis) {
+    if (redis->context) {
+        redisAsyncFree(redis->context);
+    }
+}
+
+// Contesto su cui inviare i comandi, creato alla prima richiesta e dopo ogni
+// disconnessione; NULL se Redis non è raggiungibile. La connessione si
+// completa in background: i comandi inviati prima restano nel buffer
+redisAsyncContext* redis_async_context(redis_async_t *redis) {
+    if (redis->context) {
+        return redis->context;
+    }
+    if (now_ms() < redis->retry_at_ms) {
+        return NULL;
+    }
+
+    redisAsyncContext *context = redisAsyncConnect(redis->host, redis->port);
+    if (context == NULL || context->err) {
+        fprintf(stderr, "Errore connessione Redis asincrona: %s (nuovo tentativo tra %d ms)\n",
+                context ? context->errstr : "impossibile allocare il contesto", redis->backoff_ms);
+        if (context) {
+            redisAsyncFree(context);
+        }
+        schedule_retry(redis);
+        return NULL;
+    }
+
+    context->data = redis;
+    context->ev.data = redis;
+    context->ev.addRead = add_read;
+    context->ev.delRead = del_read;
+    context->ev.addWrite = add_write;
+    context->ev.delWrite = del_write;
+    context->ev.cleanup = cleanup;
+    redisAsyncSetConnectCallback(context, on_connect);
+    redisAsyncSetDisconnectCallback(context, on_disconnect);
+
+    redis->context = context;
+    redis->fd = context->c.fd;
+    return context;
+}
+
+// Eventi epoll sul socket di Redis. Una lettura può chiudere la connessione
+// e liberare il contesto, che va quindi ricontrollato prima della scrittura
+void redis_async_handle_events(redis_async_t *redis, uint32_t events) {
+    redisAsyncContext *context = redis->context;
+
+    if (context && (events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+        redisAsyncHandleRead(context);
+    }
+
+    if (redis->context == context && context && (events & (EPOLLOUT | EPOLLERR))) {
+        redisAsyncHandleWrite(context);
+    }
+}
@@ -0,0 +1,187 @@
+// redis_pool.c
+//
+// Pool di connessioni Redis ad uso esclusivo: la lista degli slot liberi è
+// lock-free e un semaforo conta gli slot disponibili, quindi checkout non
+// prende mutex ma si blocca in sem_wait a pool esaurito. Le connessioni
+// cadute vengono ricreate con un backoff esponenziale.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "redis_pool.h"
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Nuovo tentativo di connessione per uno slot senza contesto. Se fallisce,
+// il prossimo è rimandato e l'attesa raddoppia fino a REDIS_BACKOFF_MAX_MS
+static bool slot_connect(redis_pool_t *pool, redis_slot_t *slot, uint64_t now) {
+    struct timeval timeout = {
+        .tv_sec = REDIS_CONNECT_TIMEOUT_MS / 1000,
+        .tv_usec = (REDIS_CONNECT_TIMEOUT_MS % 1000) * 1000
+    };
+
+    redisContext *context = redisConnectWithTimeout(pool->host, pool->port, timeout);
+    if (context == NULL || context->err) {
+        fprintf(stderr, "Errore connessione Redis: %s (nuovo tentativo tra %d ms)\n",
+                context ? context->errstr : "impossibile allocare il contesto", slot->backoff_ms);
+        if (context) {
+            redisFree(context);
+        }
+
+        slot->retry_at_ms = now + slot->backoff_ms;
+        slot->backoff_ms = slot->backoff_ms * 2 < REDIS_BACKOFF_MAX_MS ? slot->backoff_ms * 2 : REDIS_BACKOFF_MAX_MS;
+        return false;
+    }
+
+    // Senza timeout un Redis che non risponde bloccherebbe per sempre il
+    // PING del health check e le risposte attese dai worker
+    struct timeval command_timeout = {
+        .tv_sec = REDIS_COMMAND_TIMEOUT_MS / 1000,
+        .tv_usec = (REDIS_COMMAND_TIMEOUT_MS % 1000) * 1000
+    };
+    if (redisSetTimeout(context, command_timeout) != REDIS_OK) {
+        fprintf(stderr, "Impossibile impostare il timeout dei comandi Redis\n");
+    }
+
+    slot->context = context;
+    slot->backoff_ms = REDIS_BACKOFF_MIN_MS;
+    slot->last_used_ms = now;
+    return true;
+}
+
+static void slot_disconnect(redis_slot_t *slot, const char *reason) {
+    fprintf(stderr, "Connessione Redis scartata: %s\n", reason);
+    redisFree(slot->context);
+    slot->context = NULL;
+}
+
+// Stack di Treiber: next dello slot e testa cambiano insieme con una CAS,
+// la versione nella testa distingue due stati con lo stesso primo slot
+static void push_free(redis_pool_t *pool, redis_slot_t *slot) {
+    uint32_t index = (uint32_t)(slot - pool->slots) + 1;
+    uint64_t head = atomic_load_explicit(&pool->free_head, memory_order_relaxed);
+    uint64_t new_head;
+
+    do {
+        atomic_store_explicit(&slot->next, (uint32_t)head, memory_order_relaxed);
+        new_head = (((head >> 32) + 1) << 32) | index;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_head, &head, new_head,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+// Chiamata solo dopo aver preso un'unità dal semaforo: la lista non è vuota
+static redis_slot_t* pop_free(redis_pool_t *pool) {
+    uint64_t head = atomic_load_explicit(&pool->free_head, memory_order_acquire);
+    uint64_t new_head;
+    redis_slot_t *slot;
+
+    do {
+        slot = &pool->slots[(uint32_t)head - 1];
+        uint32_t next = atomic_load_explicit(&slot->next, memory_order_relaxed);
+        new_head = (((head >> 32) + 1) << 32) | next;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_head, &head, new_head,
+                                                    memory_order_acquire, memory_order_acquire));
+
+    return slot;
+}
+
+// Prepara size slot e prova a connetterli tutti. Un Redis irraggiungibile
+// all'avvio non è fatale: gli slot restano disconnessi e si riconnettono
+// al primo uso. Ritorna -1 solo se mancano le risorse del pool
+int redis_pool_init(redis_pool_t *pool, int size, const char *host, int port) {
+    pool->slots = calloc(size, sizeof(redis_slot_t));
+    if (!pool->slots) {
+        return -1;
+    }
+
+    if (sem_init(&pool->available, 0, 0) != 0) {
+        free(pool->slots);
+        return -1;
+    }
+
+    pool->size = size;
+    pool->host = host;
+    pool->port = port;
+    atomic_init(&pool->free_head, 0);
+
+    uint64_t now = now_ms();
+    int connected = 0;
+    for (int i = 0; i < size; i++) {
+        redis_slot_t *slot = &pool->slots[i];
+        atomic_init(&slot->next, 0);
+        slot->backoff_ms = REDIS_BACKOFF_MIN_MS;
+        connected += slot_connect(pool, slot, now);
+
+        push_free(pool, slot);
+        sem_post(&pool->available);
+    }
+
+    printf("Pool Redis inizializzato: %d/%d connessioni attive\n", connected, size);
+    return 0;
+}
+
+// Da chiamare dopo che tutti gli slot sono stati restituiti
+void redis_pool_destroy(redis_pool_t *pool) {
+    for (int i = 0; i < pool->size; i++) {
+        if (pool->slots[i].context) {
+            redisFree(pool->slots[i].context);
+        }
+    }
+
+    sem_destroy(&pool->available);
+    free(pool->slots);
+    pool->slots = NULL;
+    pool->size = 0;
+}
+
+// Prende uno slot in uso esclusivo, aspettando se sono tutti occupati
+redis_slot_t* redis_pool_checkout(redis_pool_t *pool) {
+    while (sem_wait(&pool->available) != 0) {
+        if (errno != EINTR) {
+            return NULL;
+        }
+    }
+    return pop_free(pool);
+}
+
+void redis_pool_checkin(redis_pool_t *pool, redis_slot_t *slot) {
+    push_free(pool, slot);
+    sem_post(&pool->available);
+}
+
+// Contesto pronto all'uso per uno slot in mano al chiamante: scarta una
+// connessione in errore o che non risponde al PING dopo un periodo di
+// inattività, e la ricrea se il backoff lo permette. NULL se Redis non è
+// raggiungibile in questo momento
+redisContext* redis_slot_context(redis_pool_t *pool, redis_slot_t *slot) {
+    uint64_t now = now_ms();
+
+    if (slot->context && slot->context->err) {
+        slot_disconnect(slot, slot->context->errstr);
+    }
+
+    if (slot->context && now - slot->last_used_ms >= REDIS_HEALTH_CHECK_INTERVAL_MS) {
+        redisReply *reply = redisCommand(slot->context, "PING");
+        bool healthy = reply && reply->type != REDIS_REPLY_ERROR;
+        if (reply) {
+            freeReplyObject(reply);
+        }
+        if (!healthy) {
+            slot_disconnect(slot, "nessuna risposta al PING");
+        }
+    }
+
+    if (!slot->context) {
+        if (now < slot->retry_at_ms || !slot_connect(pool, slot, now)) {
+            return NULL;
+        }
+    }
+
+    slot->last_used_ms = now;
+    return slot->context;
+}
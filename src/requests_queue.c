@@ -1,3 +1,5 @@
+#include <errno.h>
+#include <time.h>
 #include "requests_queue.h"
 
 request_queue_t* createQueue(int maxSize) {
@@ -60,6 +62,29 @@ request_queue_t* createQueue(int maxSize) {
     return q;
 }
 
+// Nodo vuoto in cui il parser scrive la richiesta; viaggia per puntatore dal
+// reactor al worker, che lo libera con free_request_node
+client_request_node_t* create_request_node(void) {
+    client_request_node_t *node = malloc(sizeof(client_request_node_t));
+    if (node == NULL) {
+        printf("Errore: impossibile allocare memoria per il nuovo nodo\n");
+        return NULL;
+    }
+
+    node->client_fd = -1;
+    node->connection = NULL;
+    node->next = NULL;
+    http_request_init(&node->request);
+    return node;
+}
+
+void free_request_node(client_request_node_t *node) {
+    if (node == NULL) return;
+
+    http_request_clear(&node->request);
+    free(node);
+}
+
 
 // Funzione per verificare se la coda è vuota
 bool isEmpty(request_queue_t* q) {
@@ -149,15 +174,8 @@ bool enqueue(request_queue_t* q, http_request_t *request) {
     return true;
 }
 
-bool enqueue_node(request_queue_t* q, client_request_node_t *node) {
-    if (q == NULL) {
-        printf("Errore: coda non inizializzata\n");
-        return false;
-    }
-
-    // Attendi uno slot vuoto (semaforo)
-    sem_wait(&q->emptySlots);
-    
+// Inserisce il nodo dopo che il chiamante ha ottenuto uno slot da emptySlots
+static bool insert_node(request_queue_t* q, client_request_node_t *node) {
     // Acquisisci il mutex per accesso esclusivo
     pthread_mutex_lock(&q->mutex);
 
@@ -204,6 +222,33 @@ bool enqueue_node(request_queue_t* q, client_request_node_t *node) {
     return true;
 }
 
+bool enqueue_node(request_queue_t* q, client_request_node_t *node) {
+    if (q == NULL) {
+        printf("Errore: coda non inizializzata\n");
+        return false;
+    }
+
+    // Attendi uno slot vuoto (semaforo)
+    sem_wait(&q->emptySlots);
+
+    return insert_node(q, node);
+}
+
+// Versione non bloccante per il reactor: se la coda è piena ritorna subito
+// false e il nodo resta al chiamante
+bool try_enqueue_node(request_queue_t* q, client_request_node_t *node) {
+    if (q == NULL) {
+        printf("Errore: coda non inizializzata\n");
+        return false;
+    }
+
+    if (sem_trywait(&q->emptySlots) != 0) {
+        return false;
+    }
+
+    return insert_node(q, node);
+}
+
 
 // Funzione per rimuovere un elemento dalla coda (dequeue/pop)
 bool dequeue(request_queue_t* q, http_request_t* request) {
@@ -258,10 +303,12 @@ bool dequeue(request_queue_t* q, http_request_t* request) {
 }
 
 
-// Funzione per rimuovere un elemento dalla coda ma funziona piu a basso livello 
-bool dequeue_node(request_queue_t* q, client_request_node_t* node) {
+// Funzione per rimuovere un elemento dalla coda ma funziona piu a basso livello:
+// il nodo passa al chiamante così com'è, senza copiare la richiesta.
+// Ritorna NULL se la coda è in shutdown.
+client_request_node_t* dequeue_node(request_queue_t* q) {
 
-    if (q == NULL || node == NULL) return false;
+    if (q == NULL) return NULL;
 
     // Attendi un elemento pieno (semaforo)
     sem_wait(&q->fullSlots);
@@ -278,16 +325,14 @@ bool dequeue_node(request_queue_t* q, client_request_node_t* node) {
     if (q->shutdownFlag && isEmptyUnsafe(q)) {
         pthread_mutex_unlock(&q->mutex);
         sem_post(&q->fullSlots); // Rilascia il semaforo
-        return false;
+        return NULL;
     }
 
 
-    client_request_node_t* temp = q->front;
-    //*request = temp->request;
-    *node =  *temp;
-    
+    client_request_node_t* node = q->front;
     
     q->front = q->front->next;
+    node->next = NULL;
     
     // Se la coda diventa vuota
     if (q->front == NULL) {
@@ -297,9 +342,6 @@ bool dequeue_node(request_queue_t* q, client_request_node_t* node) {
     q->size--;
     q->totalConsumed++;
     
-
-    free(temp);
-    
     // Segnala che la coda non è piena
     pthread_cond_signal(&q->notFull);
     
@@ -309,7 +351,77 @@ bool dequeue_node(request_queue_t* q, client_request_node_t* node) {
     // Segnala che c'è uno slot vuoto
     sem_post(&q->emptySlots);
     
-    return true;
+    return node;
+}
+
+// Nodo in testa quando il semaforo fullSlots è già stato preso; NULL se nel
+// frattempo la coda è stata svuotata (shutdown)
+static client_request_node_t* take_front(request_queue_t* q) {
+    pthread_mutex_lock(&q->mutex);
+
+    client_request_node_t* node = q->front;
+    if (node == NULL) {
+        pthread_mutex_unlock(&q->mutex);
+        sem_post(&q->fullSlots);
+        return NULL;
+    }
+
+    q->front = node->next;
+    node->next = NULL;
+    if (q->front == NULL) {
+        q->rear = NULL;
+    }
+
+    q->size--;
+    q->totalConsumed++;
+
+    pthread_cond_signal(&q->notFull);
+    pthread_mutex_unlock(&q->mutex);
+    sem_post(&q->emptySlots);
+
+    return node;
+}
+
+// Preleva fino a max nodi in nodes: aspetta il primo come dequeue_node, poi
+// prende quelli già in coda e, con linger_us > 0, attende al più linger_us
+// microsecondi dall'arrivo del primo che se ne aggiungano altri.
+// Ritorna il numero di nodi prelevati, 0 solo in shutdown
+int dequeue_batch(request_queue_t* q, client_request_node_t** nodes, int max, int linger_us) {
+    if (q == NULL || max <= 0) return 0;
+
+    nodes[0] = dequeue_node(q);
+    if (nodes[0] == NULL) {
+        return 0;
+    }
+
+    struct timespec deadline;
+    if (linger_us > 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)linger_us * 1000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+    }
+
+    int count = 1;
+    while (count < max) {
+        int result = sem_trywait(&q->fullSlots);
+        if (result != 0 && linger_us > 0) {
+            do {
+                result = sem_timedwait(&q->fullSlots, &deadline);
+            } while (result != 0 && errno == EINTR);
+        }
+        if (result != 0) {
+            break;      // Coda vuota e attesa scaduta
+        }
+
+        client_request_node_t* node = take_front(q);
+        if (node == NULL) {
+            break;
+        }
+        nodes[count++] = node;
+    }
+
+    return count;
 }
 
 
@@ -335,9 +447,16 @@ bool peekRear(request_queue_t* q, http_request_t* request) {
     return true;
 }
 
-// Funzione per stampare tutti gli elementi della coda
+// Funzione per stampare tutti gli elementi della coda. Solo per il debug:
+// tiene il mutex della coda per tutta la stampa
 void printQueue(request_queue_t* q) {
-    if (isEmpty(q)) {
+    if (q == NULL) return;
+
+    // I nodi possono essere liberati da un altro worker: serve il mutex
+    pthread_mutex_lock(&q->mutex);
+
+    if (isEmptyUnsafe(q)) {
+        pthread_mutex_unlock(&q->mutex);
         printf("Coda vuota\n");
         return;
     }
@@ -349,6 +468,8 @@ void printQueue(request_queue_t* q) {
         current = current->next;
     }
     printf("(dimensione: %d)\n", q->size);
+
+    pthread_mutex_unlock(&q->mutex);
 }
 
 // Funzione per svuotare completamente la coda
@@ -0,0 +1,339 @@
+// router.c
+//
+// Router a radix tree: ogni nodo consuma un tratto statico del path (i
+// prefissi comuni sono condivisi) oppure un segmento {parametro}. La ricerca
+// costa quanto la lunghezza del path, indipendentemente dal numero di route:
+// il figlio statico si trova con un indice sul primo carattere.
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "router.h"
+
+typedef struct router_node {
+    char *prefix;                           // Testo statico consumato dal nodo
+    size_t prefix_len;
+    struct router_node **children;          // Figli statici, ognuno con un primo carattere diverso
+    int child_count;
+    uint8_t child_index[256];               // Primo carattere -> indice + 1 in children
+    struct router_node *param;              // Figlio {nome}: consuma un segmento fino al '/'
+    char *param_name;                       // Nome del parametro (solo nei nodi parametro)
+    route_handler_fn handlers[HTTP_UNKNOWN];
+    unsigned int methods;                   // Bitmask dei metodi con un handler
+} router_node_t;
+
+static router_node_t* node_create(const char *prefix, size_t length) {
+    router_node_t *node = calloc(1, sizeof(router_node_t));
+    if (!node) {
+        return NULL;
+    }
+
+    node->prefix = strndup(prefix, length);
+    if (!node->prefix) {
+        free(node);
+        return NULL;
+    }
+    node->prefix_len = length;
+    return node;
+}
+
+static void node_destroy(router_node_t *node) {
+    if (!node) return;
+
+    for (int i = 0; i < node->child_count; i++) {
+        node_destroy(node->children[i]);
+    }
+    node_destroy(node->param);
+    free(node->children);
+    free(node->prefix);
+    free(node->param_name);
+    free(node);
+}
+
+static router_node_t* node_child(const router_node_t *node, char first) {
+    uint8_t slot = node->child_index[(unsigned char)first];
+    return slot ? node->children[slot - 1] : NULL;
+}
+
+static int node_add_child(router_node_t *node, router_node_t *child) {
+    if (node->child_count >= UINT8_MAX) {
+        return -1;
+    }
+
+    router_node_t **children = realloc(node->children, (node->child_count + 1) * sizeof(router_node_t *));
+    if (!children) {
+        return -1;
+    }
+
+    node->children = children;
+    node->children[node->child_count++] = child;
+    node->child_index[(unsigned char)child->prefix[0]] = (uint8_t)node->child_count;
+    return 0;
+}
+
+// Divide child dopo i primi common caratteri: il nuovo nodo intermedio
+// prende il suo posto tra i figli di parent
+static router_node_t* node_split(router_node_t *parent, router_node_t *child, size_t common) {
+    router_node_t *middle = node_create(child->prefix, common);
+    if (!middle) {
+        return NULL;
+    }
+
+    char *rest = strdup(child->prefix + common);
+    if (!rest) {
+        node_destroy(middle);
+        return NULL;
+    }
+
+    free(child->prefix);
+    child->prefix = rest;
+    child->prefix_len -= common;
+
+    if (node_add_child(middle, child) < 0) {
+        node_destroy(middle);
+        return NULL;
+    }
+
+    uint8_t slot = parent->child_index[(unsigned char)middle->prefix[0]];
+    parent->children[slot - 1] = middle;
+    return middle;
+}
+
+// Scende (creando e dividendo nodi) lungo il tratto statico text[0..length)
+static router_node_t* insert_static(router_node_t *node, const char *text, size_t length) {
+    while (length > 0) {
+        router_node_t *child = node_child(node, text[0]);
+
+        if (!child) {
+            child = node_create(text, length);
+            if (!child || node_add_child(node, child) < 0) {
+                node_destroy(child);
+                return NULL;
+            }
+            return child;
+        }
+
+        size_t common = 0;
+        while (common < child->prefix_len && common < length && child->prefix[common] == text[common]) {
+            common++;
+        }
+
+        if (common < child->prefix_len) {
+            child = node_split(node, child, common);
+            if (!child) {
+                return NULL;
+            }
+        }
+
+        node = child;
+        text += common;
+        length -= common;
+    }
+
+    return node;
+}
+
+static router_node_t* insert_param(router_node_t *node, const char *name, size_t length) {
+    if (node->param) {
+        // Due nomi diversi nella stessa posizione renderebbero ambiguo il match
+        if (strlen(node->param->param_name) != length || strncmp(node->param->param_name, name, length) != 0) {
+            return NULL;
+        }
+        return node->param;
+    }
+
+    router_node_t *param = node_create("", 0);
+    if (!param) {
+        return NULL;
+    }
+
+    param->param_name = strndup(name, length);
+    if (!param->param_name) {
+        node_destroy(param);
+        return NULL;
+    }
+
+    node->param = param;
+    return param;
+}
+
+int router_init(router_t *router) {
+    router->root = node_create("", 0);
+    return router->root ? 0 : -1;
+}
+
+int router_add(router_t *router, http_method_t method, const char *pattern, route_handler_fn handler) {
+    if (!router || !router->root || !pattern || pattern[0] != '/' || method >= HTTP_UNKNOWN || !handler) {
+        printf("Errore: route non valida %s %s\n", method_to_string(method), pattern ? pattern : "(null)");
+        return -1;
+    }
+
+    router_node_t *node = router->root;
+    const char *p = pattern;
+
+    while (node && *p) {
+        if (*p == '{') {
+            const char *end = strchr(p, '}');
+            // Un parametro occupa un segmento intero
+            if (!end || end == p + 1 || (end[1] != '/' && end[1] != '\0')) {
+                printf("Errore: parametro non valido nella route %s\n", pattern);
+                return -1;
+            }
+            node = insert_param(node, p + 1, end - p - 1);
+            p = end + 1;
+        } else {
+            size_t run = strcspn(p, "{");
+            node = insert_static(node, p, run);
+            p += run;
+        }
+    }
+
+    if (!node) {
+        printf("Errore: impossibile aggiungere la route %s %s\n", method_to_string(method), pattern);
+        return -1;
+    }
+
+    if (node->handlers[method]) {
+        printf("Errore: route duplicata %s %s\n", method_to_string(method), pattern);
+        return -1;
+    }
+
+    node->handlers[method] = handler;
+    node->methods |= 1u << method;
+    return 0;
+}
+
+int router_add_routes(router_t *router, const route_t *routes, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (router_add(router, routes[i].method, routes[i].pattern, routes[i].handler) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// I tratti statici hanno la precedenza sui parametri; se la strada statica
+// non porta a una route si torna indietro e si prova il parametro
+static const router_node_t* node_match(const router_node_t *node, const char *path, const char *end,
+                                       route_params_t *params) {
+    if (path == end) {
+        return node->methods ? node : NULL;
+    }
+
+    const router_node_t *child = node_child(node, *path);
+    if (child && (size_t)(end - path) >= child->prefix_len && memcmp(path, child->prefix, child->prefix_len) == 0) {
+        const router_node_t *found = node_match(child, path + child->prefix_len, end, params);
+        if (found) {
+            return found;
+        }
+    }
+
+    if (node->param && params->count < ROUTER_MAX_PARAMS) {
+        const char *segment_end = memchr(path, '/', end - path);
+        if (!segment_end) {
+            segment_end = end;
+        }
+
+        if (segment_end > path) {
+            route_param_t *param = &params->items[params->count++];
+            param->name = node->param->param_name;
+            param->value = path;
+            param->length = segment_end - path;
+
+            const router_node_t *found = node_match(node->param, segment_end, end, params);
+            if (found) {
+                return found;
+            }
+            params->count--;
+        }
+    }
+
+    return NULL;
+}
+
+router_result_t router_match(const router_t *router, http_method_t method, const char *path,
+                             size_t length, route_match_t *match) {
+    match->handler = NULL;
+    match->params.count = 0;
+    match->allowed_methods = 0;
+
+    const router_node_t *node = node_match(router->root, path, path + length, &match->params);
+    if (!node) {
+        return ROUTER_NOT_FOUND;
+    }
+
+    match->allowed_methods = node->methods;
+    if (method >= HTTP_UNKNOWN || !node->handlers[method]) {
+        return ROUTER_METHOD_NOT_ALLOWED;
+    }
+
+    match->handler = node->handlers[method];
+    return ROUTER_MATCH;
+}
+
+// Valore dell'header Allow per una risposta 405
+int router_allow_header(unsigned int allowed_methods, char *buffer, size_t size) {
+    size_t written = 0;
+    buffer[0] = '\0';
+
+    for (int method = 0; method < HTTP_UNKNOWN; method++) {
+        if (!(allowed_methods & (1u << method))) {
+            continue;
+        }
+
+        int n = snprintf(buffer + written, size - written, "%s%s", written ? ", " : "", method_to_string(method));
+        if (n < 0 || (size_t)n >= size - written) {
+            return -1;
+        }
+        written += n;
+    }
+
+    return 0;
+}
+
+void router_destroy(router_t *router) {
+    node_destroy(router->root);
+    router->root = NULL;
+}
+
+const char* route_param(const route_params_t *params, const char *name, size_t *length) {
+    for (int i = 0; i < params->count; i++) {
+        if (strcmp(params->items[i].name, name) == 0) {
+            if (length) {
+                *length = params->items[i].length;
+            }
+            return params->items[i].value;
+        }
+    }
+    return NULL;
+}
+
+// Parametro numerico: solo cifre decimali ([0-9]+, senza segno né spazi) e
+// non oltre INT_MAX. ROUTE_PARAM_MISSING se manca, ROUTE_PARAM_INVALID se c'è
+// ma non è un intero non negativo valido
+int route_param_int(const route_params_t *params, const char *name, int *value) {
+    size_t length;
+    const char *text = route_param(params, name, &length);
+    if (!text) {
+        return ROUTE_PARAM_MISSING;
+    }
+    if (length == 0) {
+        return ROUTE_PARAM_INVALID;
+    }
+
+    int parsed = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            return ROUTE_PARAM_INVALID;
+        }
+
+        int digit = text[i] - '0';
+        if (parsed > (INT_MAX - digit) / 10) {
+            return ROUTE_PARAM_INVALID;
+        }
+        parsed = parsed * 10 + digit;
+    }
+
+    *value = parsed;
+    return 0;
+}
@@ -0,0 +1,303 @@
+// server_config.c
+
+#include <getopt.h>
+#include <string.h>
+#include "server_config.h"
+
+server_config_t server_config;
+
+// Opzioni disponibili solo in forma lunga
+enum {
+    OPT_HEADER_TIMEOUT = 256,
+    OPT_BODY_TIMEOUT,
+    OPT_IDLE_TIMEOUT,
+    OPT_WRITE_TIMEOUT,
+    OPT_GZIP_LEVEL,
+    OPT_GZIP_MIN_SIZE,
+    OPT_REDIS_POOL_SIZE,
+    OPT_REDIS_PIN,
+    OPT_BATCH_SIZE,
+    OPT_BATCH_LINGER,
+    OPT_REDIS_ASYNC,
+    OPT_BOOK_CACHE_SIZE,
+    OPT_BOOK_CACHE_TTL
+};
+
+void init_server_config(server_config_t *config) {
+    config->port = DEFAULT_SERVER_PORT;
+    config->worker_threads = DEFAULT_WORKER_THREADS;
+    config->keepalive_max_requests = DEFAULT_KEEPALIVE_MAX_REQUESTS;
+    config->reactors = DEFAULT_REACTORS;
+    config->max_events = DEFAULT_MAX_EVENTS;
+    config->edge_triggered = false;
+    config->io_uring = false;
+    config->queue_size = DEFAULT_QUEUE_SIZE;
+    config->overload_policy = OVERLOAD_PAUSE;
+    config->retry_after = DEFAULT_RETRY_AFTER;
+    config->header_timeout = DEFAULT_HEADER_TIMEOUT;
+    config->body_timeout = DEFAULT_BODY_TIMEOUT;
+    config->idle_timeout = DEFAULT_IDLE_TIMEOUT;
+    config->write_timeout = DEFAULT_WRITE_TIMEOUT;
+    config->max_body_size = DEFAULT_MAX_BODY_SIZE;
+    config->gzip_level = DEFAULT_GZIP_LEVEL;
+    config->gzip_min_size = DEFAULT_GZIP_MIN_SIZE;
+    config->redis_pool_size = DEFAULT_REDIS_POOL_SIZE;
+    config->redis_pin = false;
+    config->batch_size = DEFAULT_BATCH_SIZE;
+    config->batch_linger_us = DEFAULT_BATCH_LINGER_US;
+    config->redis_async = false;
+    config->book_cache_size = DEFAULT_BOOK_CACHE_SIZE;
+    config->book_cache_ttl = DEFAULT_BOOK_CACHE_TTL;
+}
+
+static void print_usage(const char *prog) {
+    printf("Uso: %s [opzioni]\n", prog);
+    printf("  -p, --port <n>                porta di ascolto (default %d)\n", DEFAULT_SERVER_PORT);
+    printf("  -w, --workers <n>             numero di worker thread (default %d)\n", DEFAULT_WORKER_THREADS);
+    printf("  -k, --keepalive-requests <n>  richieste per connessione keep-alive, 0 = disabilitato (default %d)\n",
+           DEFAULT_KEEPALIVE_MAX_REQUESTS);
+    printf("  -r, --reactors <n>            numero di event loop paralleli (default %d)\n", DEFAULT_REACTORS);
+    printf("  -e, --max-events <n>          eventi per chiamata a epoll_wait (default %d)\n", DEFAULT_MAX_EVENTS);
+    printf("  -E, --edge-triggered          usa epoll in modalità edge-triggered\n");
+    printf("  -U, --io-uring                usa io_uring al posto di epoll\n");
+    printf("  -q, --queue-size <n>          capacità della coda verso i worker (default %d)\n", DEFAULT_QUEUE_SIZE);
+    printf("  -o, --overload <policy>       con la coda piena: pause (sospende la lettura) o reject (503) (default pause)\n");
+    printf("  -R, --retry-after <s>         secondi di Retry-After nelle risposte 503 (default %d)\n", DEFAULT_RETRY_AFTER);
+    printf("      --header-timeout <s>      tempo massimo per ricevere gli header, 0 = nessuno (default %d)\n",
+           DEFAULT_HEADER_TIMEOUT);
+    printf("      --body-timeout <s>        tempo massimo per ricevere il body (default %d)\n", DEFAULT_BODY_TIMEOUT);
+    printf("      --idle-timeout <s>        attesa massima tra richieste keep-alive (default %d)\n", DEFAULT_IDLE_TIMEOUT);
+    printf("      --write-timeout <s>       tempo massimo per inviare una risposta (default %d)\n", DEFAULT_WRITE_TIMEOUT);
+    printf("  -b, --max-body-size <n>[k|m]  dimensione massima del body in byte (default %d)\n", DEFAULT_MAX_BODY_SIZE);
+    printf("      --gzip-level <n>          livello di compressione 1-9, 0 = disabilitata (default %d)\n", DEFAULT_GZIP_LEVEL);
+    printf("      --gzip-min-size <n>[k|m]  body più piccoli non vengono compressi (default %d)\n", DEFAULT_GZIP_MIN_SIZE);
+    printf("      --redis-pool-size <n>     connessioni Redis nel pool (default %d)\n", DEFAULT_REDIS_POOL_SIZE);
+    printf("      --redis-pin               una connessione Redis fissa per worker (pool >= worker)\n");
+    printf("      --batch-size <n>          richieste per round trip verso Redis, 1-%d (default %d)\n",
+           MAX_BATCH_SIZE, DEFAULT_BATCH_SIZE);
+    printf("      --batch-linger <us>       attesa massima per riempire un batch, 0 = nessuna (default %d)\n",
+           DEFAULT_BATCH_LINGER_US);
+    printf("      --redis-async             client Redis asincrono nei reactor, senza worker (solo epoll)\n");
+    printf("      --cache-size <n>[k|m]     memoria della cache dei libri, 0 = disabilitata (default %d)\n",
+           DEFAULT_BOOK_CACHE_SIZE);
+    printf("      --cache-ttl <s>           secondi di validità di un libro in cache (default %d)\n", DEFAULT_BOOK_CACHE_TTL);
+    printf("  -h, --help                    mostra questo messaggio\n");
+}
+
+// Converte un argomento numerico controllando che sia valido e >= min_value
+static int parse_int_option(const char *name, const char *value, int min_value, int *out) {
+    char *end;
+    long parsed = strtol(value, &end, 10);
+
+    if (*value == '\0' || *end != '\0' || parsed < min_value || parsed > 1000000000L) {
+        fprintf(stderr, "Valore non valido per --%s: %s\n", name, value);
+        return -1;
+    }
+
+    *out = (int)parsed;
+    return 0;
+}
+
+// Dimensione in byte con suffisso opzionale k o m (es. 512k, 8m), da
+// min_value byte a 1 GB
+static int parse_size_option(const char *name, const char *value, long min_value, size_t *out) {
+    char *end;
+    long parsed = strtol(value, &end, 10);
+    long multiplier = 1;
+
+    if (*end == 'k' || *end == 'K') {
+        multiplier = 1024;
+        end++;
+    } else if (*end == 'm' || *end == 'M') {
+        multiplier = 1024 * 1024;
+        end++;
+    }
+
+    if (*value == '\0' || *end != '\0' || parsed < min_value || parsed > (1L << 30) / multiplier) {
+        fprintf(stderr, "Valore non valido per --%s: %s\n", name, value);
+        return -1;
+    }
+
+    *out = (size_t)(parsed * multiplier);
+    return 0;
+}
+
+// Ritorna 0 se la configurazione è valida, 1 se è stato richiesto l'help, -1 in caso di errore
+int parse_server_config(int argc, char **argv, server_config_t *config) {
+    static const struct option long_options[] = {
+        {"port",               required_argument, NULL, 'p'},
+        {"workers",            required_argument, NULL, 'w'},
+        {"keepalive-requests", required_argument, NULL, 'k'},
+        {"reactors",           required_argument, NULL, 'r'},
+        {"max-events",         required_argument, NULL, 'e'},
+        {"edge-triggered",     no_argument,       NULL, 'E'},
+        {"io-uring",           no_argument,       NULL, 'U'},
+        {"queue-size",         required_argument, NULL, 'q'},
+        {"overload",           required_argument, NULL, 'o'},
+        {"retry-after",        required_argument, NULL, 'R'},
+        {"header-timeout",     required_argument, NULL, OPT_HEADER_TIMEOUT},
+        {"body-timeout",       required_argument, NULL, OPT_BODY_TIMEOUT},
+        {"idle-timeout",       required_argument, NULL, OPT_IDLE_TIMEOUT},
+        {"write-timeout",      required_argument, NULL, OPT_WRITE_TIMEOUT},
+        {"max-body-size",      required_argument, NULL, 'b'},
+        {"gzip-level",         required_argument, NULL, OPT_GZIP_LEVEL},
+        {"gzip-min-size",      required_argument, NULL, OPT_GZIP_MIN_SIZE},
+        {"redis-pool-size",    required_argument, NULL, OPT_REDIS_POOL_SIZE},
+        {"redis-pin",          no_argument,       NULL, OPT_REDIS_PIN},
+        {"batch-size",         required_argument, NULL, OPT_BATCH_SIZE},
+        {"batch-linger",       required_argument, NULL, OPT_BATCH_LINGER},
+        {"redis-async",        no_argument,       NULL, OPT_REDIS_ASYNC},
+        {"cache-size",         required_argument, NULL, OPT_BOOK_CACHE_SIZE},
+        {"cache-ttl",          required_argument, NULL, OPT_BOOK_CACHE_TTL},
+        {"help",               no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:w:k:r:e:EUq:o:R:b:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'p':
+                if (parse_int_option("port", optarg, 1, &config->port) < 0) return -1;
+                break;
+            case 'w':
+                if (parse_int_option("workers", optarg, 1, &config->worker_threads) < 0) return -1;
+                break;
+            case 'k':
+                if (parse_int_option("keepalive-requests", optarg, 0, &config->keepalive_max_requests) < 0) return -1;
+                break;
+            case 'r':
+                if (parse_int_option("reactors", optarg, 1, &config->reactors) < 0) return -1;
+                break;
+            case 'e':
+                if (parse_int_option("max-events", optarg, 1, &config->max_events) < 0) return -1;
+                break;
+            case 'E':
+                config->edge_triggered = true;
+                break;
+            case 'U':
+                config->io_uring = true;
+                break;
+            case 'q':
+                if (parse_int_option("queue-size", optarg, 1, &config->queue_size) < 0) return -1;
+                break;
+            case 'o':
+                if (strcmp(optarg, "pause") == 0) {
+                    config->overload_policy = OVERLOAD_PAUSE;
+                } else if (strcmp(optarg, "reject") == 0) {
+                    config->overload_policy = OVERLOAD_REJECT;
+                } else {
+                    fprintf(stderr, "Valore non valido per --overload: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'R':
+                if (parse_int_option("retry-after", optarg, 0, &config->retry_after) < 0) return -1;
+                break;
+            case OPT_HEADER_TIMEOUT:
+                if (parse_int_option("header-timeout", optarg, 0, &config->header_timeout) < 0) return -1;
+                break;
+            case OPT_BODY_TIMEOUT:
+                if (parse_int_option("body-timeout", optarg, 0, &config->body_timeout) < 0) return -1;
+                break;
+            case OPT_IDLE_TIMEOUT:
+                if (parse_int_option("idle-timeout", optarg, 0, &config->idle_timeout) < 0) return -1;
+                break;
+            case OPT_WRITE_TIMEOUT:
+                if (parse_int_option("write-timeout", optarg, 0, &config->write_timeout) < 0) return -1;
+                break;
+            case 'b':
+                if (parse_size_option("max-body-size", optarg, 1, &config->max_body_size) < 0) return -1;
+                break;
+            case OPT_GZIP_LEVEL:
+                if (parse_int_option("gzip-level", optarg, 0, &config->gzip_level) < 0) return -1;
+                if (config->gzip_level > 9) {
+                    fprintf(stderr, "Valore non valido per --gzip-level: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case OPT_GZIP_MIN_SIZE:
+                if (parse_size_option("gzip-min-size", optarg, 1, &config->gzip_min_size) < 0) return -1;
+                break;
+            case OPT_REDIS_POOL_SIZE:
+                if (parse_int_option("redis-pool-size", optarg, 1, &config->redis_pool_size) < 0) return -1;
+                break;
+            case OPT_REDIS_PIN:
+                config->redis_pin = true;
+                break;
+            case OPT_BATCH_SIZE:
+                if (parse_int_option("batch-size", optarg, 1, &config->batch_size) < 0) return -1;
+                if (config->batch_size > MAX_BATCH_SIZE) {
+                    fprintf(stderr, "Valore non valido per --batch-size: massimo %d\n", MAX_BATCH_SIZE);
+                    return -1;
+                }
+                break;
+            case OPT_BATCH_LINGER:
+                if (parse_int_option("batch-linger", optarg, 0, &config->batch_linger_us) < 0) return -1;
+                break;
+            case OPT_REDIS_ASYNC:
+                config->redis_async = true;
+                break;
+            case OPT_BOOK_CACHE_SIZE:
+                if (parse_size_option("cache-size", optarg, 0, &config->book_cache_size) < 0) return -1;
+                break;
+            case OPT_BOOK_CACHE_TTL:
+                if (parse_int_option("cache-ttl", optarg, 1, &config->book_cache_ttl) < 0) return -1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 1;
+            default:
+                print_usage(argv[0]);
+                return -1;
+        }
+    }
+
+    // Ogni worker ne tiene una: con meno connessioni alcuni non partirebbero mai
+    if (config->redis_pin && config->redis_pool_size < config->worker_threads) {
+        fprintf(stderr, "Con --redis-pin servono almeno %d connessioni Redis (--redis-pool-size)\n",
+                config->worker_threads);
+        return -1;
+    }
+
+    // L'adattatore hiredis registra il socket di Redis in epoll
+    if (config->redis_async && config->io_uring) {
+        fprintf(stderr, "--redis-async non è supportato con --io-uring\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+void print_server_config(const server_config_t *config) {
+    printf("=== CONFIGURAZIONE ===\n");
+    printf("Porta: %d\n", config->port);
+    printf("Worker thread: %d\n", config->worker_threads);
+    printf("Richieste per connessione keep-alive: %d\n", config->keepalive_max_requests);
+    printf("Reactor: %d\n", config->reactors);
+    printf("Eventi per epoll_wait: %d\n", config->max_events);
+    printf("Backend di rete: %s\n", config->io_uring ? "io_uring" : "epoll");
+    printf("Modalità epoll: %s\n", config->edge_triggered ? "edge-triggered" : "level-triggered");
+    printf("Coda worker: %d richieste, se piena: %s\n", config->queue_size,
+           config->overload_policy == OVERLOAD_REJECT ? "503" : "pausa lettura");
+    printf("Timeout (s): header %d, body %d, idle %d, write %d\n", config->header_timeout,
+           config->body_timeout, config->idle_timeout, config->write_timeout);
+    printf("Body massimo: %zu byte\n", config->max_body_size);
+    if (config->gzip_level > 0) {
+        printf("Compressione: livello %d, da %zu byte\n", config->gzip_level, config->gzip_min_size);
+    } else {
+        printf("Compressione: disabilitata\n");
+    }
+    printf("Pool Redis: %d connessioni%s\n", config->redis_pool_size,
+           config->redis_pin ? ", una fissa per worker" : "");
+    if (config->redis_async) {
+        printf("Client Redis: asincrono nei reactor\n");
+    } else {
+        printf("Batch Redis: fino a %d richieste, attesa %d us\n", config->batch_size, config->batch_linger_us);
+    }
+    if (config->book_cache_size > 0) {
+        printf("Cache libri: %zu byte, TTL %d s\n", config->book_cache_size, config->book_cache_ttl);
+    } else {
+        printf("Cache libri: disabilitata\n");
+    }
+    printf("======================\n");
+}
@@ -1,9 +1,15 @@
 // server_utils.c
 
+#define _GNU_SOURCE
+#include <sys/resource.h>
+#include <sys/eventfd.h>
 #include "server_utils.h"
 #include "http_utils.h"
+#include "http_scan.h"
+#include "server_config.h"
 #include "workers.h"
 #include "book.h"
+#include "uring_backend.h"
 
 // DEFINIZIONI delle variabili globali (solo qui!)
 int server_fd;    
@@ -20,6 +26,10 @@ struct sockaddr_in client_addr;
 struct epoll_event client_event;
 request_queue_t *requests_q;
 
+// Reactor avviati, per svegliare quelli in attesa di spazio nella coda
+static reactor_t *started_reactors = NULL;
+static int started_reactor_count = 0;
+
 
 
 int set_nonblocking(int sockfd) {
@@ -38,7 +48,9 @@ int set_nonblocking(int sockfd) {
 }
 
 
-int init_server_socket(int port){
+// Ritorna -1 in caso di errore, così chi avvia i reactor può annullare
+// quelli già creati
+int init_server_socket(int port, bool reuse_port){
     
     int server_fd;
     // allows the association of a socket with a specific IP address and port.
@@ -46,7 +58,20 @@ int init_server_socket(int port){
 
     if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) < 0){
         perror("socket failed");
-        exit(EXIT_FAILURE);
+        return -1;
+    }
+
+    int enable = 1;
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0){
+        perror("setsockopt SO_REUSEADDR failed");
+    }
+
+    // Con più reactor ognuno ha il proprio socket sulla stessa porta e il
+    // kernel distribuisce le nuove connessioni tra i socket
+    if (reuse_port && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0){
+        perror("setsockopt SO_REUSEPORT failed");
+        close(server_fd);
+        return -1;
     }
 
     serv_addr.sin_family = AF_INET;
@@ -55,16 +80,16 @@ int init_server_socket(int port){
 
     if (bind(server_fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0){
         perror("bind failed");
-        exit(EXIT_FAILURE);
+        close(server_fd);
+        return -1;
     }
 
-    if (listen(server_fd, MAX_CLIENTS) < 0){
+    if (listen(server_fd, MAX_CLIENTS) < 0 || set_nonblocking(server_fd) < 0){
         perror("listen failed");
-        exit(EXIT_FAILURE);
+        close(server_fd);
+        return -1;
     }
 
-    set_nonblocking(server_fd);
-
     return server_fd;
 
 }
@@ -97,110 +122,725 @@ int add_fd_to_epoll_istance(int fd_to_monitor, int epoll_istance, int event_type
     return 0;
 }
 
-// Funzioni helper per migliorare la leggibilità
- int handle_new_connection(int server_fd, int epoll_fd) {
-    struct sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    
-    int new_client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &client_len);
-    
-    if (new_client_fd < 0) {
-        perror("Accept failed");
+// Registrazione di un client: a differenza di add_fd_to_epoll_istance, usata
+// solo all'avvio, non termina il processo. Con ENOMEM o ENOSPC
+// (max_user_watches) si perde la connessione, non il reactor
+int add_client_fd_to_epoll_istance(int fd_to_monitor, int epoll_istance, int event_type){
+
+    struct epoll_event event;
+    event.events = event_type;
+    event.data.fd = fd_to_monitor;
+
+    if (epoll_ctl(epoll_istance, EPOLL_CTL_ADD, fd_to_monitor, &event) == -1)
+    {
+        perror("epoll_ctl: add client");
         return -1;
     }
-    
-    printf("Client connesso con successo\n");
-    
-    if (set_nonblocking(new_client_fd) < 0) {
-        close(new_client_fd);
+
+    return 0;
+}
+
+// A differenza di add_fd_to_epoll_istance non termina il processo: un
+// errore su un singolo client non deve fermare il server
+int modify_fd_in_epoll_istance(int fd_to_monitor, int epoll_istance, int event_type){
+
+    struct epoll_event event;
+    event.events = event_type;
+    event.data.fd = fd_to_monitor;
+
+    if (epoll_ctl(epoll_istance, EPOLL_CTL_MOD, fd_to_monitor, &event) == -1)
+    {
+        perror("epoll_ctl: mod client");
         return -1;
     }
-    
-    if (add_fd_to_epoll_istance(new_client_fd, epoll_fd, EPOLLIN) < 0) {
-        close(new_client_fd);
+
+    return 0;
+}
+
+int reactor_init(reactor_t *reactor, int id, int listen_fd) {
+    memset(reactor, 0, sizeof(reactor_t));
+    reactor->id = id;
+    reactor->listen_fd = listen_fd;
+    reactor->epoll_fd = -1;
+    reactor->spare_fd = -1;
+    reactor->max_events = server_config.max_events;
+    reactor->edge_triggered = server_config.edge_triggered;
+    timer_wheel_init(&reactor->timers);
+
+    // I worker notificano le risposte pronte scrivendo sull'eventfd
+    reactor->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor->event_fd < 0) {
+        perror("eventfd failed");
         return -1;
     }
-    
+
+    if (pthread_mutex_init(&reactor->completed_mutex, NULL) != 0) {
+        printf("Errore: impossibile inizializzare il mutex del reactor\n");
+        close(reactor->event_fd);
+        return -1;
+    }
+
+    // Senza riserva il reactor funziona lo stesso, ma con gli fd esauriti
+    // non può scartare le connessioni in attesa
+    reactor->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    // Se il kernel non supporta io_uring (o è bloccato) si ripiega su epoll
+    if (server_config.io_uring) {
+        if (uring_reactor_init(reactor) == 0) {
+            return 0;
+        }
+        printf("Reactor %d: io_uring non disponibile, uso epoll\n", id);
+    }
+
+    reactor->epoll_fd = init_epoll_istance();
+    reactor->events = malloc(sizeof(struct epoll_event) * reactor->max_events);
+    if (!reactor->events) {
+        pthread_mutex_destroy(&reactor->completed_mutex);
+        close(reactor->event_fd);
+        close(reactor->epoll_fd);
+        if (reactor->spare_fd >= 0) {
+            close(reactor->spare_fd);
+        }
+        return -1;
+    }
+
+    add_fd_to_epoll_istance(listen_fd, reactor->epoll_fd, EPOLLIN | (reactor->edge_triggered ? EPOLLET : 0));
+    add_fd_to_epoll_istance(reactor->event_fd, reactor->epoll_fd, EPOLLIN);
+
+    if (server_config.redis_async) {
+        reactor->redis_async = true;
+        redis_async_init(&reactor->redis, reactor->epoll_fd, REDIS_HOST, REDIS_PORT);
+        http_compressor_init(&reactor->compressor, server_config.gzip_level, server_config.gzip_min_size);
+    }
+
     return 0;
 }
 
-int handle_client_data(int client_fd) {
-    char receiving_buffer[BUFFER_SIZE];
-    memset(receiving_buffer, 0, BUFFER_SIZE);
-    
-    ssize_t received_data_size = recv(client_fd, receiving_buffer, BUFFER_SIZE - 1, 0);
-    
-    if (received_data_size > 0) {
-        // Dati ricevuti con successo
-        receiving_buffer[received_data_size] = '\0';
-        
-        http_request_t *request = create_http_request();
-        if (!request) {
-            printf("Errore nella creazione della richiesta HTTP\n");
+static void reactor_wakeup(reactor_t *reactor) {
+    uint64_t one = 1;
+    if (write(reactor->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("write eventfd failed");
+    }
+}
+
+// Chiamata dai worker: consegna la risposta al reactor della connessione,
+// che la scriverà sul socket senza bloccare il worker
+void reactor_post_completion(connection_t *conn, http_response_t *response, bool keep_alive) {
+    reactor_t *reactor = conn->reactor;
+
+    conn->completed_response = response;
+    conn->completed_keep_alive = keep_alive;
+    conn->next_completed = NULL;
+
+    pthread_mutex_lock(&reactor->completed_mutex);
+    if (reactor->completed_tail) {
+        reactor->completed_tail->next_completed = conn;
+    } else {
+        reactor->completed_head = conn;
+    }
+    reactor->completed_tail = conn;
+    pthread_mutex_unlock(&reactor->completed_mutex);
+
+    reactor_wakeup(reactor);
+}
+
+// Chiamata dai worker dopo ogni dequeue: sveglia i reactor che hanno
+// richieste in attesa di uno slot libero
+void reactor_notify_capacity(void) {
+    int count = __atomic_load_n(&started_reactor_count, __ATOMIC_ACQUIRE);
+
+    for (int i = 0; i < count; i++) {
+        if (__atomic_load_n(&started_reactors[i].stalled_count, __ATOMIC_SEQ_CST) > 0) {
+            reactor_wakeup(&started_reactors[i]);
+        }
+    }
+}
+
+// Risposta 503 per le richieste scartate quando la coda dei worker è piena
+static http_response_t* create_overload_response(bool keep_alive) {
+    http_response_t *response = create_http_response();
+    if (!response) {
+        return NULL;
+    }
+
+    char retry_after[16];
+    snprintf(retry_after, sizeof(retry_after), "%d", server_config.retry_after);
+
+    set_response_status(response, HTTP_SERVICE_UNAVAILABLE);
+    add_response_header(response, "Retry-After", retry_after);
+    static const char body[] = "{\"error\": \"Server sovraccarico, riprova più tardi\"}";
+    set_response_body_ref(response, body, sizeof(body) - 1, "application/json; charset=utf-8");
+    set_response_keep_alive(response, keep_alive);
+
+    if (build_response(response) != 0) {
+        free_http_response(response);
+        return NULL;
+    }
+
+    return response;
+}
+
+// Risposta a una richiesta che il parser ha rifiutato. La connessione viene
+// chiusa dopo l'invio: il resto dell'input non è più delimitabile
+static http_response_t* create_parse_error_response(http_status_t status) {
+    http_response_t *response = create_http_response();
+    if (!response) {
+        return NULL;
+    }
+
+    const char *message;
+    switch (status) {
+        case HTTP_PAYLOAD_TOO_LARGE: message = "{\"error\": \"Body della richiesta troppo grande\"}"; break;
+        case HTTP_REQUEST_HEADER_FIELDS_TOO_LARGE: message = "{\"error\": \"Header della richiesta troppo grandi\"}"; break;
+        case HTTP_NOT_IMPLEMENTED: message = "{\"error\": \"Transfer-Encoding non supportato\"}"; break;
+        default: message = "{\"error\": \"Richiesta non valida\"}"; break;
+    }
+
+    // Messaggi statici: il body non viene copiato nella risposta
+    set_response_status(response, status);
+    set_response_body_ref(response, message, strlen(message), "application/json; charset=utf-8");
+    set_response_keep_alive(response, false);
+
+    if (build_response(response) != 0) {
+        free_http_response(response);
+        return NULL;
+    }
+
+    return response;
+}
+
+// La coda dei worker è piena: il reactor non attende uno slot ma applica la
+// politica configurata. In entrambi i casi la connessione resta in_flight,
+// quindi non vengono lette altre richieste finché questa non ha risposta.
+static int handle_queue_full(connection_t *conn, client_request_node_t *node) {
+    reactor_t *reactor = conn->reactor;
+
+    if (server_config.overload_policy == OVERLOAD_REJECT) {
+        bool keep_alive = http_request_keep_alive(&node->request);
+        http_response_t *response = create_overload_response(keep_alive);
+        if (!response) {
             return -1;
         }
+
+        free_request_node(node);
+        conn->requests_served++;
+
+        // Passa dalla lista delle completion come una risposta dei worker,
+        // così l'invio è identico per entrambi i backend
+        reactor_post_completion(conn, response, keep_alive);
+        return 0;
+    }
+
+    conn->stalled_node = node;
+    conn->next_stalled = NULL;
+    if (reactor->stalled_tail) {
+        reactor->stalled_tail->next_stalled = conn;
+    } else {
+        reactor->stalled_head = conn;
+    }
+    reactor->stalled_tail = conn;
+    __atomic_add_fetch(&reactor->stalled_count, 1, __ATOMIC_SEQ_CST);
+
+    // Un worker potrebbe aver liberato uno slot prima di vedere il contatore:
+    // il reactor si sveglia da solo per un ultimo tentativo, così la notifica
+    // non può andare persa
+    reactor_wakeup(reactor);
+    return 0;
+}
+
+// Riprova ad accodare le richieste in attesa, nell'ordine di arrivo. Le
+// connessioni chiuse nel frattempo passano nella lista delle completion
+// senza risposta, così il backend le libera come le altre.
+static connection_t* retry_stalled_requests(reactor_t *reactor, connection_t *completed) {
+    while (reactor->stalled_head) {
+        connection_t *conn = reactor->stalled_head;
+        client_request_node_t *node = conn->stalled_node;
+
+        if (conn->closing) {
+            free_request_node(node);
+            conn->completed_response = NULL;
+            conn->next_completed = completed;
+            completed = conn;
+        } else if (!try_enqueue_node(worker_pool->queue, node)) {
+            break;
+        }
+
+        conn->stalled_node = NULL;
+        reactor->stalled_head = conn->next_stalled;
+        conn->next_stalled = NULL;
+        __atomic_sub_fetch(&reactor->stalled_count, 1, __ATOMIC_SEQ_CST);
+    }
+
+    if (!reactor->stalled_head) {
+        reactor->stalled_tail = NULL;
+    }
+
+    return completed;
+}
+
+// Fase della connessione, che decide quale timeout applicare
+static connection_timer_t connection_timer_kind(connection_t *conn) {
+    if (conn->closing) {
+        return CONNECTION_TIMER_NONE;
+    }
+    if (conn->out_head) {
+        return CONNECTION_TIMER_WRITE;
+    }
+    if (conn->in_flight || conn->close_after_write) {
+        return CONNECTION_TIMER_NONE;
+    }
+    if (conn->request_node && conn->parser.state == HTTP_PARSE_BODY) {
+        return CONNECTION_TIMER_BODY;
+    }
+    // Un client appena connesso che non invia nulla ha il tempo degli
+    // headers; l'idle vale solo per l'attesa keep-alive tra una richiesta
+    // e l'altra
+    if (conn->request_node || conn->in_len > 0 || conn->requests_served == 0) {
+        return CONNECTION_TIMER_HEADER;
+    }
+    return CONNECTION_TIMER_IDLE;
+}
+
+const char* connection_timer_name(connection_timer_t kind) {
+    switch (kind) {
+        case CONNECTION_TIMER_IDLE: return "idle";
+        case CONNECTION_TIMER_HEADER: return "header";
+        case CONNECTION_TIMER_BODY: return "body";
+        case CONNECTION_TIMER_WRITE: return "write";
+        default: return "none";
+    }
+}
+
+// Riarma il timer solo quando la connessione cambia fase: la scadenza conta
+// dall'inizio della fase, non dall'ultimo byte ricevuto
+void connection_update_timer(connection_t *conn) {
+    connection_timer_t kind = connection_timer_kind(conn);
+    if (kind == conn->timer_kind) {
+        return;
+    }
+    conn->timer_kind = kind;
+
+    int seconds = 0;
+    switch (kind) {
+        case CONNECTION_TIMER_IDLE: seconds = server_config.idle_timeout; break;
+        case CONNECTION_TIMER_HEADER: seconds = server_config.header_timeout; break;
+        case CONNECTION_TIMER_BODY: seconds = server_config.body_timeout; break;
+        case CONNECTION_TIMER_WRITE: seconds = server_config.write_timeout; break;
+        default: break;
+    }
+
+    if (seconds <= 0) {
+        timer_wheel_cancel(&conn->timer);
+        return;
+    }
+
+    timer_wheel_arm(&conn->reactor->timers, &conn->timer, (uint64_t)seconds * 1000);
+}
+
+// Riarma da capo il timeout della fase in corso (es. scrittura che avanza)
+void connection_restart_timer(connection_t *conn) {
+    conn->timer_kind = CONNECTION_TIMER_NONE;
+    connection_update_timer(conn);
+}
+
+// Registra in epoll solo gli eventi che servono: EPOLLIN quando si può
+// accettare una nuova richiesta, EPOLLOUT quando c'è output in sospeso
+static int update_connection_events(connection_t *conn) {
+    uint32_t events = 0;
+
+    connection_update_timer(conn);
+
+    bool backlog = conn->out_head && conn->in_len >= CONNECTION_PIPELINE_LIMIT;
+    if (!conn->in_flight && !conn->close_after_write && !backlog) {
+        events |= EPOLLIN;
+    }
+    if (conn->out_head) {
+        events |= EPOLLOUT;
+    }
+    if (conn->reactor->edge_triggered) {
+        events |= EPOLLET;
+    }
+
+    if (events == conn->epoll_events) {
+        return 0;
+    }
+
+    if (modify_fd_in_epoll_istance(conn->fd, conn->reactor->epoll_fd, events) < 0) {
+        return -1;
+    }
+
+    conn->epoll_events = events;
+    return 0;
+}
+
+// Se un worker sta ancora usando la connessione la chiusura viene rimandata
+// a quando la sua risposta torna al reactor
+static void close_client_connection(connection_t *conn) {
+    if (conn->in_flight) {
+        epoll_ctl(conn->reactor->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+        conn->epoll_events = 0;
+        conn->closing = true;
+        return;
+    }
+
+    connection_close(conn);
+}
+
+// Con gli fd esauriti (EMFILE/ENFILE) la connessione resterebbe nella coda
+// di accept e il socket in ascolto sempre pronto: si libera il descrittore di
+// riserva per accettarla e chiuderla subito, poi lo si riapre. Comune ai
+// backend epoll e io_uring.
+void reactor_shed_connection(reactor_t *reactor) {
+    if (reactor->spare_fd >= 0) {
+        close(reactor->spare_fd);
+        int fd = accept4(reactor->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    // Se un altro thread ha preso il posto liberato ci si riprova la volta dopo
+    reactor->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+// Funzioni helper per migliorare la leggibilità
+// Accetta tutte le connessioni in coda: in modalità edge-triggered non
+// arriverebbe un nuovo evento per quelle rimaste. accept4 restituisce già
+// fd non bloccanti e close-on-exec, senza le fcntl di set_nonblocking.
+// In level-triggered il batch è limitato per non affamare gli altri fd.
+// Un errore su una singola accept non ferma mai il reactor.
+ int handle_new_connection(reactor_t *reactor) {
+    int accepted = 0;
+
+    while (reactor->edge_triggered || accepted < reactor->max_events) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
         
-        //printf("REQ : %s\n", reciving_buffer);
-        if (parse_http_request(receiving_buffer, request) != 0) {
-            printf("Errore nel parsing della richiesta HTTP\n");
-            free_http_request(request);
-            return -1;
+        int new_client_fd = accept4(reactor->listen_fd, (struct sockaddr *)&client_addr, &client_len,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+        
+        if (new_client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break; // Coda di accept vuota
+            }
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // Risorse esaurite: si rinuncia a questo giro. In edge-triggered
+                // si riarma il socket, così le connessioni rimaste in coda
+                // producono un nuovo evento al prossimo epoll_wait
+                perror("Accept failed");
+                if (errno == EMFILE || errno == ENFILE) {
+                    reactor_shed_connection(reactor);
+                }
+                if (reactor->edge_triggered) {
+                    modify_fd_in_epoll_istance(reactor->listen_fd, reactor->epoll_fd, EPOLLIN | EPOLLET);
+                }
+                break;
+            }
+            if (errno == EBADF || errno == EINVAL || errno == ENOTSOCK) {
+                perror("Accept failed");
+                return -1;
+            }
+            // Errori di rete della singola connessione (EPROTO, ENETDOWN,
+            // EPERM, ...): accept(2) consiglia di riprovare
+            perror("Accept failed");
+            continue;
         }
+        accepted++;
         
-        client_request_node_t* newNode = (client_request_node_t*)malloc(sizeof(client_request_node_t));
-        if (newNode == NULL) {
-            printf("Errore: impossibile allocare memoria per il nuovo nodo\n");
-            free_http_request(request);
-            return false;
+        connection_t *conn = connection_open(new_client_fd, reactor);
+        if (!conn) {
+            close(new_client_fd);
+            continue;
         }
 
-        newNode->request = *request;
-        newNode->next = NULL;
-        newNode->client_fd = client_fd;
-        
-        //enqueue_node(worker_pool->queue, newNode);
+        uint32_t events = EPOLLIN | (reactor->edge_triggered ? EPOLLET : 0);
+        if (add_client_fd_to_epoll_istance(new_client_fd, reactor->epoll_fd, events) < 0) {
+            connection_close(conn);
+            continue;
+        }
+        conn->epoll_events = events;
+        connection_update_timer(conn);
+    }
 
-        if (!enqueue_node(worker_pool->queue, newNode)) { 
-            free(newNode);
-            free_http_request(request);
+    if (accepted > 0) {
+        printf("Client connessi con successo: %d\n", accepted);
+    }
+    
+    return 0;
+}
+
+// Porta avanti il parsing sui byte bufferizzati e, a richiesta completa,
+// la passa ai worker (conn->in_flight). Comune ai backend epoll e io_uring.
+int dispatch_connection_request(connection_t *conn) {
+    if (conn->in_flight || conn->in_len == 0) {
+        return 0;
+    }
+
+    if (!conn->request_node) {
+        conn->request_node = create_request_node();
+        if (!conn->request_node) {
+            printf("Errore nella creazione della richiesta HTTP\n");
             return -1;
         }
-    
+        http_parser_init(&conn->parser);
+        conn->parser.max_body_size = server_config.max_body_size;
+    }
+
+    client_request_node_t *node = conn->request_node;
+    http_parse_state_t state = http_parser_execute(&conn->parser, &node->request, conn->in_buf, conn->in_len);
+
+    if (state == HTTP_PARSE_ERROR) {
+        printf("Errore nel parsing della richiesta HTTP: %d\n", conn->parser.error);
+
+        http_response_t *response = create_parse_error_response(conn->parser.error);
+        if (!response) {
+            return -1;
+        }
+
+        free_request_node(node);
+        conn->request_node = NULL;
+        conn->in_flight = true;
+        reactor_post_completion(conn, response, false);
+        return 0;
+    }
+
+    if (state != HTTP_PARSE_COMPLETE) {
+        // Richiesta incompleta: attendi il prossimo segmento. Del body chunked
+        // si tengono solo i dati decodificati, non il framing
+        conn->in_len = http_parser_compact(&conn->parser, &node->request, conn->in_buf, conn->in_len);
         return 0;
+    }
+
+    // La richiesta si porta via il buffer di ricezione che la contiene;
+    // l'eventuale pipeline resta alla connessione per la richiesta successiva
+    char *buffer = connection_detach_input(conn, conn->parser.request_length);
+    if (!buffer) {
+        printf("Errore: impossibile allocare memoria per la richiesta\n");
+        return -1;
+    }
+
+    conn->request_node = NULL;
+    http_request_set_buffer(&node->request, buffer, conn->parser.body_start);
+    node->next = NULL;
+    node->client_fd = conn->fd;
+    node->connection = conn;
+
+    // Finché il worker non risponde non si leggono altre richieste
+    conn->in_flight = true;
+
+    if (conn->reactor->redis_async) {
+        if (async_process_request(conn->reactor, node) < 0) {
+            conn->in_flight = false;
+            free_request_node(node);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (!try_enqueue_node(worker_pool->queue, node) && handle_queue_full(conn, node) < 0) {
+        conn->in_flight = false;
+        free_request_node(node);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int process_connection_input(connection_t *conn) {
+    if (dispatch_connection_request(conn) < 0) {
+        return -1;
+    }
+
+    return update_connection_events(conn);
+}
+
+// Ritorna 1 se la connessione è stata chiusa
+static int handle_client_write(connection_t *conn) {
+    output_entry_t *head = conn->out_head;
+    size_t offset = head ? head->offset : 0;
+
+    int result = connection_flush_output(conn);
+
+    if (result < 0) {
+        close_client_connection(conn);
+        return 1;
+    }
+
+    if (result == CONNECTION_FLUSH_AGAIN) {
+        // Il client sta leggendo: il timeout di scrittura riparte
+        if (head && (conn->out_head != head || head->offset != offset)) {
+            connection_restart_timer(conn);
+        }
+
+        // Buffer del kernel pieno: riprova su EPOLLOUT
+        if (update_connection_events(conn) < 0) {
+            close_client_connection(conn);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (conn->close_after_write) {
+        close_client_connection(conn);
+        return 1;
+    }
+
+    // Risposta inviata: processa eventuali richieste già arrivate in pipeline
+    if (process_connection_input(conn) < 0) {
+        close_client_connection(conn);
+        return 1;
+    }
+
+    return 0;
+}
+
+// Azzera l'eventfd e stacca la lista delle connessioni completate dai worker
+connection_t* reactor_take_completions(reactor_t *reactor) {
+    uint64_t count;
+    if (read(reactor->event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        perror("read eventfd failed");
+    }
+
+    pthread_mutex_lock(&reactor->completed_mutex);
+    connection_t *conn = reactor->completed_head;
+    reactor->completed_head = NULL;
+    reactor->completed_tail = NULL;
+    pthread_mutex_unlock(&reactor->completed_mutex);
+
+    if (reactor->stalled_head) {
+        conn = retry_stalled_requests(reactor, conn);
+    }
+
+    return conn;
+}
+
+// Risposte restituite dai worker: vengono accodate e inviate dal reactor
+static void handle_completions(reactor_t *reactor) {
+    connection_t *conn = reactor_take_completions(reactor);
+
+    while (conn) {
+        connection_t *next = conn->next_completed;
+        http_response_t *response = conn->completed_response;
+
+        conn->next_completed = NULL;
+        conn->completed_response = NULL;
+        conn->in_flight = false;
+
+        if (conn->closing || !response) {
+            free_http_response(response);
+            connection_close(conn);
+        } else if (connection_queue_output(conn, response) < 0) {
+            free_http_response(response);
+            connection_close(conn);
+        } else {
+            if (!conn->completed_keep_alive) {
+                conn->close_after_write = true;
+            }
+            handle_client_write(conn);
+        }
+
+        conn = next;
+    }
+}
+
+// In modalità edge-triggered legge finché il kernel non restituisce EAGAIN;
+// si ferma prima solo se EPOLLIN è stato tolto dalla maschera (richiesta
+// passata ai worker o troppo input in pipeline): al riarmo epoll ricontrolla
+// lo stato del socket
+int handle_client_data(connection_t *conn) {
+    do {
+        // Se il Content-Length è noto riserva subito lo spazio per tutto il body
+        // (più il '\0' che lo termina), così il buffer non viene riallocato a
+        // ogni segmento né quando passa alla richiesta
+        size_t wanted = CONNECTION_READ_CHUNK;
+        if (conn->request_node && conn->parser.state == HTTP_PARSE_BODY) {
+            size_t request_end = conn->parser.body_start + conn->request_node->request.content_length + 1;
+            if (request_end > conn->in_len && request_end - conn->in_len > wanted) {
+                wanted = request_end - conn->in_len;
+            }
+        }
+
+        if (connection_reserve_input(conn, wanted) < 0) {
+            close_client_connection(conn);
+            return -1;
+        }
         
-    } else if (received_data_size == 0) {
-        // Client disconnesso
-        printf("Client disconnesso\n");
-        close(client_fd);
-        return 1; // Indica disconnessione
+        ssize_t received_data_size = recv(conn->fd, conn->in_buf + conn->in_len, conn->in_cap - conn->in_len, 0);
         
-    } else {
-        // Errore nella recv
-        if (errno != EAGAIN && errno != EWOULDBLOCK) {
-            perror("recv failed");
-            close(client_fd);
+        if (received_data_size > 0) {
+            // Dati ricevuti con successo
+            conn->in_len += received_data_size;
+            
+        } else if (received_data_size == 0) {
+            // Client disconnesso
+            printf("Client disconnesso\n");
+            close_client_connection(conn);
+            return 1; // Indica disconnessione
+            
+        } else {
+            // Errore nella recv
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("recv failed");
+                close_client_connection(conn);
+                return -1;
+            }
+            return 0; // Non è un errore fatale
+        }
+
+        if (process_connection_input(conn) < 0) {
+            close_client_connection(conn);
             return -1;
         }
-        return 0; // Non è un errore fatale
-    }
+    } while (conn->reactor->edge_triggered && (conn->epoll_events & EPOLLIN));
+
+    return 0;
 }
 
- int process_epoll_events(int server_fd, int epoll_fd, struct epoll_event *events, int num_events) {
+ int process_epoll_events(reactor_t *reactor, struct epoll_event *events, int num_events) {
     for (int i = 0; i < num_events; i++) {
         int current_fd = events[i].data.fd;
         
-        if (current_fd == server_fd) {
+        if (current_fd == reactor->listen_fd) {
             // Nuova connessione in arrivo
-            if (handle_new_connection(server_fd, epoll_fd) < 0) {
+            if (handle_new_connection(reactor) < 0) {
                 printf("Errore nell'accettare la connessione\n");
                 // Continua comunque con gli altri eventi
             }
+        } else if (current_fd == reactor->event_fd) {
+            // Risposte pronte dai worker
+            handle_completions(reactor);
+        } else if (reactor->redis_async && current_fd == reactor->redis.fd) {
+            // Risposte (o spazio di scrittura) sulla connessione Redis
+            redis_async_handle_events(&reactor->redis, events[i].events);
         } else {
+            connection_t *conn = connection_get(current_fd);
+            if (!conn) {
+                continue; // Evento di un fd già chiuso in questo ciclo
+            }
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close_client_connection(conn);
+                continue;
+            }
+
+            // Il socket è tornato scrivibile: riprendi l'invio
+            if ((events[i].events & EPOLLOUT) && handle_client_write(conn) != 0) {
+                continue;
+            }
+
             // Dati pronti per la lettura da un client
-            int result = handle_client_data(current_fd);
-            if (result < 0) {
-                printf("Errore nella gestione dei dati del client\n");
-                // Continua comunque con gli altri eventi
+            if ((events[i].events & EPOLLIN) && !conn->in_flight) {
+                int result = handle_client_data(conn);
+                if (result < 0) {
+                    printf("Errore nella gestione dei dati del client\n");
+                    // Continua comunque con gli altri eventi
+                }
             }
         }
     }
@@ -208,42 +848,174 @@ int handle_client_data(int client_fd) {
     return 0;
 }
 
-int initialize_server(int port) {
+// Dimensione della tabella delle connessioni: un fd non può superare RLIMIT_NOFILE
+static int get_max_fds() {
+    struct rlimit limit;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY
+            && limit.rlim_cur > MAX_CLIENTS) {
+        return (int)limit.rlim_cur;
+    }
+
+    return MAX_CLIENTS;
+}
+
+int initialize_server() {
     printf("Avvio del server...\n");
-    
 
-    worker_pool = worker_pool_init(10,worker_thread);
+    // Sceglie la scansione SIMD del parser prima che partano reactor e worker
+    http_scan_init();
+    printf("Scansione HTTP: %s\n", http_scan_level_name(http_scan_level()));
+    http_date_refresh();
     
-    // Inizializza il socket del server
-    int server_fd = init_server_socket(port);
-    if (server_fd < 0) {
-        printf("Errore nell'inizializzazione del socket del server\n");
+    if (init_connection_table(get_max_fds(), server_config.max_body_size) < 0) {
         return -1;
     }
-    
-    /*
 
-    // Inizializza epoll
-    int epoll_fd = init_epoll_istance();
-    if (epoll_fd < 0) {
-        printf("Errore nell'inizializzazione di epoll\n");
-        close(server_fd);
+    worker_pool = worker_pool_init(server_config.worker_threads, worker_thread);
+    if (!worker_pool) {
+        printf("Errore nell'inizializzazione del pool di worker\n");
         return -1;
     }
-    
-    // Aggiungi il server socket a epoll
-    if (add_fd_to_epoll_istance(server_fd, epoll_fd, EPOLLIN) < 0) {
-        printf("Errore nell'aggiunta del server socket a epoll\n");
-        close(server_fd);
-        close(epoll_fd);
-        return -1;
+
+    return 0;
+}
+
+// Chiude una connessione il cui timer è scaduto
+static void handle_connection_timeout(timer_entry_t *entry, void *arg) {
+    connection_t *conn = entry->data;
+    (void)arg;
+
+    printf("Timeout %s sul fd %d: connessione chiusa\n", connection_timer_name(conn->timer_kind), conn->fd);
+    conn->timer_kind = CONNECTION_TIMER_NONE;
+    close_client_connection(conn);
+}
+
+// Main event loop di un reactor
+void reactor_run(reactor_t *reactor) {
+    if (reactor->uring) {
+        uring_reactor_run(reactor);
+        return;
     }
+
+    while (!__atomic_load_n(&reactor->stopping, __ATOMIC_ACQUIRE)) {
+        // Con timer armati epoll_wait si risveglia al prossimo tick della ruota
+        int timeout = timer_wheel_next_timeout(&reactor->timers);
+        int num_events = epoll_wait(reactor->epoll_fd, reactor->events, reactor->max_events, timeout);
+        http_date_refresh();
+        
+        if (num_events == -1) {
+            if (errno == EINTR) {
+                // Segnale ricevuto, continua
+                continue;
+            }
+            perror("epoll_wait failed");
+            break;
+        }
+        
+        if (num_events > 0) {
+            if (process_epoll_events(reactor, reactor->events, num_events) < 0) {
+                printf("Errore nel processare gli eventi\n");
+                // Potresti decidere se continuare o uscire
+            }
+        }
+
+        timer_wheel_advance(&reactor->timers, handle_connection_timeout, reactor);
+    }
+}
+
+static void* reactor_thread(void *arg) {
+    reactor_t *reactor = (reactor_t *)arg;
+
+    reactor_run(reactor);
+
+    // Fermato da start_reactors: le risorse le libera chi lo ha fermato
+    if (__atomic_load_n(&reactor->stopping, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    cleanup_resources(reactor->listen_fd, reactor->epoll_fd);
+    return NULL;
+}
+
+// Libera un reactor inizializzato da reactor_init il cui loop non gira più
+static void reactor_destroy(reactor_t *reactor) {
+    if (reactor->uring) {
+        uring_reactor_destroy(reactor);
+    }
+    if (reactor->redis_async) {
+        redis_async_destroy(&reactor->redis);
+        http_compressor_destroy(&reactor->compressor);
+    }
+
+    cleanup_resources(reactor->listen_fd, reactor->epoll_fd);
+    close(reactor->event_fd);
+    if (reactor->spare_fd >= 0) {
+        close(reactor->spare_fd);
+    }
+    free(reactor->events);
+    pthread_mutex_destroy(&reactor->completed_mutex);
+}
+
+// Ferma i thread dei reactor [1, count) già avviati e libera i primi
+// initialized reactor: annulla un avvio fallito a metà
+static void abort_reactors(reactor_t *reactors, int initialized, int threads) {
+    for (int i = 1; i < threads; i++) {
+        __atomic_store_n(&reactors[i].stopping, true, __ATOMIC_RELEASE);
+        reactor_wakeup(&reactors[i]);
+        pthread_join(reactors[i].thread, NULL);
+    }
+
+    for (int i = 0; i < initialized; i++) {
+        reactor_destroy(&reactors[i]);
+    }
+    free(reactors);
+}
+
+// Crea count reactor, ciascuno con la propria istanza epoll e il proprio
+// socket in ascolto sulla porta (SO_REUSEPORT). I reactor dal secondo in poi
+// girano su thread dedicati; il primo va eseguito dal chiamante con reactor_run.
+// Se un passo fallisce, quanto già avviato viene fermato e liberato.
+reactor_t* start_reactors(int count, int port) {
+    reactor_t *reactors = calloc(count, sizeof(reactor_t));
+    if (!reactors) {
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int listen_fd = init_server_socket(port, count > 1);
+        if (listen_fd < 0) {
+            printf("Errore nella creazione del socket del reactor %d\n", i);
+            abort_reactors(reactors, i, 0);
+            return NULL;
+        }
+        if (reactor_init(&reactors[i], i, listen_fd) < 0) {
+            printf("Errore nell'inizializzazione del reactor %d\n", i);
+            close(listen_fd);
+            abort_reactors(reactors, i, 0);
+            return NULL;
+        }
+    }
+
+    for (int i = 1; i < count; i++) {
+        if (pthread_create(&reactors[i].thread, NULL, reactor_thread, &reactors[i]) != 0) {
+            printf("Errore nella creazione del thread del reactor %d\n", i);
+            abort_reactors(reactors, count, i);
+            return NULL;
+        }
+    }
+
+    reactors[0].thread = pthread_self();
+
+    // Da qui i worker possono svegliare i reactor quando la coda si libera.
+    // Un reactor rimasto in attesa prima di questo punto viene svegliato
+    // dalla prossima richiesta prelevata dalla coda
+    started_reactors = reactors;
+    __atomic_store_n(&started_reactor_count, count, __ATOMIC_RELEASE);
+
+    printf("Server in ascolto sulla porta %d con %d reactor\n", port, count);
     
-    */
-    
-    printf("Server in ascolto sulla porta %d\n", port);
-    
-    return server_fd; // Ritorna il file descriptor del server
+    return reactors;
 }
 
  void cleanup_resources(int server_fd, int epoll_fd) {
@@ -0,0 +1,131 @@
+// timer_wheel.c
+//
+// Ruota dei timer hashed: ogni timer finisce nello slot (scadenza % SLOTS).
+// Avanzare di un tick visita un solo slot e scade solo i timer di quel giro,
+// senza mai scorrere tutte le connessioni.
+
+#include <stddef.h>
+#include <time.h>
+#include "timer_wheel.h"
+
+uint64_t timer_wheel_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t timer_wheel_tick_at(timer_wheel_t *wheel, uint64_t now_ms) {
+    return (now_ms - wheel->start_ms) / TIMER_WHEEL_TICK_MS;
+}
+
+void timer_wheel_init(timer_wheel_t *wheel) {
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        wheel->slots[i].prev = &wheel->slots[i];
+        wheel->slots[i].next = &wheel->slots[i];
+    }
+
+    wheel->start_ms = timer_wheel_now_ms();
+    wheel->current_tick = 0;
+    wheel->count = 0;
+}
+
+void timer_entry_init(timer_entry_t *entry, void *data) {
+    entry->prev = NULL;
+    entry->next = NULL;
+    entry->wheel = NULL;
+    entry->expires = 0;
+    entry->data = data;
+}
+
+static void timer_entry_unlink(timer_entry_t *entry) {
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->prev = NULL;
+    entry->next = NULL;
+    entry->wheel->count--;
+    entry->wheel = NULL;
+}
+
+// (Ri)arma il timer perché scada tra timeout_ms, arrotondati al tick successivo
+void timer_wheel_arm(timer_wheel_t *wheel, timer_entry_t *entry, uint64_t timeout_ms) {
+    if (entry->wheel) {
+        timer_entry_unlink(entry);
+    }
+
+    uint64_t ticks = (timeout_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+    entry->expires = timer_wheel_tick_at(wheel, timer_wheel_now_ms()) + (ticks ? ticks : 1);
+
+    // Un timer non può finire in uno slot già superato da current_tick
+    if (entry->expires <= wheel->current_tick) {
+        entry->expires = wheel->current_tick + 1;
+    }
+
+    timer_entry_t *head = &wheel->slots[entry->expires & (TIMER_WHEEL_SLOTS - 1)];
+    entry->next = head->next;
+    entry->prev = head;
+    head->next->prev = entry;
+    head->next = entry;
+    entry->wheel = wheel;
+    wheel->count++;
+}
+
+void timer_wheel_cancel(timer_entry_t *entry) {
+    if (entry->wheel) {
+        timer_entry_unlink(entry);
+    }
+}
+
+// Millisecondi da attendere (per epoll_wait) prima del prossimo tick, -1 se
+// non ci sono timer armati
+int timer_wheel_next_timeout(timer_wheel_t *wheel) {
+    if (wheel->count == 0) {
+        return -1;
+    }
+
+    uint64_t next_ms = wheel->start_ms + (wheel->current_tick + 1) * TIMER_WHEEL_TICK_MS;
+    uint64_t now_ms = timer_wheel_now_ms();
+
+    return next_ms > now_ms ? (int)(next_ms - now_ms) : 0;
+}
+
+// Porta la ruota all'istante attuale e chiama expire per ogni timer scaduto.
+// Se è passato più di un giro basta visitare ogni slot una volta.
+void timer_wheel_advance(timer_wheel_t *wheel, timer_expire_fn expire, void *arg) {
+    uint64_t now_tick = timer_wheel_tick_at(wheel, timer_wheel_now_ms());
+    if (now_tick <= wheel->current_tick) {
+        return;
+    }
+
+    uint64_t steps = now_tick - wheel->current_tick;
+    if (steps > TIMER_WHEEL_SLOTS) {
+        steps = TIMER_WHEEL_SLOTS;
+    }
+
+    // Prima si staccano i timer scaduti, poi si chiamano le callback: una
+    // callback libera l'oggetto che contiene il proprio timer
+    timer_entry_t *expired = NULL;
+
+    for (uint64_t i = 1; i <= steps; i++) {
+        timer_entry_t *head = &wheel->slots[(wheel->current_tick + i) & (TIMER_WHEEL_SLOTS - 1)];
+        timer_entry_t *entry = head->next;
+
+        while (entry != head) {
+            timer_entry_t *next = entry->next;
+            if (entry->expires <= now_tick) {
+                timer_entry_unlink(entry);
+                entry->next = expired;
+                expired = entry;
+            }
+            entry = next;
+        }
+    }
+
+    wheel->current_tick = now_tick;
+
+    while (expired) {
+        timer_entry_t *next = expired->next;
+        expired->next = NULL;
+        expire(expired, arg);
+        expired = next;
+    }
+}
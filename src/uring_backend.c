@@ -0,0 +1,781 @@
+// uring_backend.c
+//
+// Backend io_uring del reactor, alternativo a epoll. Usa direttamente le
+// syscall (io_uring_setup/enter/register) senza dipendere da liburing.
+// Ogni connessione ha al più una recv multishot attiva, che riceve nei buffer
+// forniti al kernel tramite buffer ring, e una send alla volta sulla testa
+// della coda di output; l'ultima risposta di una connessione da chiudere è
+// collegata (IOSQE_IO_LINK) alla close del socket. Accept e notifiche dei
+// worker sono anch'esse multishot, quindi a regime ogni giro del loop è una
+// sola io_uring_enter che invia le nuove SQE e attende le completion.
+
+#define _GNU_SOURCE
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "uring_backend.h"
+
+// Tipo di operazione nei bit bassi di user_data; il resto è il puntatore alla
+// connessione (allineato a 16 byte da calloc), o 0 per accept ed eventfd
+enum {
+    URING_OP_ACCEPT = 1,
+    URING_OP_EVENTFD,
+    URING_OP_RECV,
+    URING_OP_SEND,
+    URING_OP_CLOSE,
+    URING_OP_CANCEL,            // Cancellazione della recv
+    URING_OP_CANCEL_SEND,       // Cancellazione della send (chiusura con client che non legge)
+};
+#define URING_OP_MASK 7ULL
+
+typedef struct uring {
+    int ring_fd;
+
+    // Submission queue condivisa con il kernel
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local_tail;         // SQE preparate, pubblicate alla prossima enter
+    struct io_uring_sqe *sqes;
+
+    // Completion queue
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *ring_ptr;
+    size_t ring_size;
+    size_t sqes_size;
+
+    // Buffer ring per le recv
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    char *buffers;
+    unsigned short buf_tail;
+
+    // Al posto dell'accept è armato un poll sul socket in ascolto (fd esauriti)
+    bool accept_polling;
+} uring_t;
+
+static void uring_close_connection(connection_t *conn);
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                              void *arg, size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// Pubblica le SQE preparate e, se wait è vero, attende almeno una completion
+// per al più timeout_ms (-1 = senza limite, come epoll_wait)
+static int uring_submit(uring_t *ring, bool wait, int timeout_ms) {
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+    unsigned to_submit = ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (to_submit == 0 && !wait) {
+        return 0;
+    }
+
+    if (!wait) {
+        return sys_io_uring_enter(ring->ring_fd, to_submit, 0, 0, NULL, 0);
+    }
+
+    if (timeout_ms < 0) {
+        return sys_io_uring_enter(ring->ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    }
+
+    struct __kernel_timespec ts = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_nsec = (long long)(timeout_ms % 1000) * 1000000
+    };
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (uint64_t)(uintptr_t)&ts;
+
+    return sys_io_uring_enter(ring->ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                              &arg, sizeof(arg));
+}
+
+// Restituisce una SQE azzerata; se la submission queue è piena la svuota prima
+static struct io_uring_sqe* uring_get_sqe(uring_t *ring, int op, void *data) {
+    while (ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        if (uring_submit(ring, false, -1) < 0 && errno != EINTR && errno != EBUSY) {
+            perror("io_uring_enter failed");
+            return NULL;
+        }
+    }
+
+    unsigned index = ring->sq_local_tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (uint64_t)(uintptr_t)data | (uint64_t)op;
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+
+    return sqe;
+}
+
+// Restituisce al kernel il buffer bid dopo averne copiato il contenuto
+static void uring_recycle_buffer(uring_t *ring, unsigned short bid) {
+    struct io_uring_buf *buf = &ring->buf_ring->bufs[ring->buf_tail & (URING_BUFFER_COUNT - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)(ring->buffers + (size_t)bid * URING_BUFFER_SIZE);
+    buf->len = URING_BUFFER_SIZE;
+    buf->bid = bid;
+    ring->buf_tail++;
+
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+static int uring_arm_accept(reactor_t *reactor) {
+    struct io_uring_sqe *sqe = uring_get_sqe(reactor->uring, URING_OP_ACCEPT, NULL);
+    if (!sqe) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = reactor->listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    return 0;
+}
+
+// Con gli fd esauriti l'accept fallisce subito a ogni riarmo, anche a coda
+// vuota: si attende invece con un poll one-shot che arrivi una connessione.
+// La CQE porta lo stesso tag dell'accept
+static int uring_arm_accept_poll(reactor_t *reactor) {
+    struct io_uring_sqe *sqe = uring_get_sqe(reactor->uring, URING_OP_ACCEPT, NULL);
+    if (!sqe) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = reactor->listen_fd;
+    sqe->poll32_events = POLLIN;
+    reactor->uring->accept_polling = true;
+    return 0;
+}
+
+// L'eventfd resta sorvegliato da un poll multishot; il contatore viene
+// azzerato da reactor_take_completions
+static int uring_arm_eventfd(reactor_t *reactor) {
+    struct io_uring_sqe *sqe = uring_get_sqe(reactor->uring, URING_OP_EVENTFD, NULL);
+    if (!sqe) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = reactor->event_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    return 0;
+}
+
+static int uring_arm_recv(connection_t *conn) {
+    struct io_uring_sqe *sqe = uring_get_sqe(conn->reactor->uring, URING_OP_RECV, conn);
+    if (!sqe) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+
+    conn->recv_armed = true;
+    conn->recv_canceling = false;
+    conn->uring_pending++;
+    return 0;
+}
+
+static int uring_cancel_recv(connection_t *conn) {
+    if (!conn->recv_armed || conn->recv_canceling) {
+        return 0;
+    }
+
+    struct io_uring_sqe *sqe = uring_get_sqe(conn->reactor->uring, URING_OP_CANCEL, conn);
+    if (!sqe) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)conn | URING_OP_RECV;
+
+    conn->recv_canceling = true;
+    conn->uring_pending++;
+    return 0;
+}
+
+// Una send bloccata su un client che non legge tiene vivo il socket anche
+// dopo la close: va cancellata perché la connessione si chiuda davvero
+static int uring_cancel_send(connection_t *conn) {
+    if (!conn->send_armed) {
+        return 0;
+    }
+
+    struct io_uring_sqe *sqe = uring_get_sqe(conn->reactor->uring, URING_OP_CANCEL_SEND, conn);
+    if (!sqe) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)conn | URING_OP_SEND;
+
+    conn->uring_pending++;
+    return 0;
+}
+
+static int uring_queue_close(connection_t *conn) {
+    struct io_uring_sqe *sqe = uring_get_sqe(conn->reactor->uring, URING_OP_CLOSE, conn);
+    if (!sqe) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = conn->fd;
+
+    conn->close_queued = true;
+    conn->uring_pending++;
+    return 0;
+}
+
+// Invia la testa della coda di output. Se è l'ultima risposta di una
+// connessione da chiudere, la close viene collegata alla send: il kernel la
+// esegue solo se la send va a buon fine, senza un altro giro nel reactor.
+static int uring_arm_send(connection_t *conn) {
+    if (conn->send_armed || !conn->out_head || conn->fd_closed) {
+        return 0;
+    }
+
+    output_entry_t *entry = conn->out_head;
+    bool link_close = conn->close_after_write && !entry->next && !conn->close_queued;
+
+    // Niente altre letture su una connessione in chiusura
+    if (link_close && uring_cancel_recv(conn) < 0) {
+        return -1;
+    }
+
+    struct io_uring_sqe *sqe = uring_get_sqe(conn->reactor->uring, URING_OP_SEND, conn);
+    if (!sqe) {
+        return -1;
+    }
+
+    // Status line, headers e body partono insieme senza essere concatenati
+    memset(&conn->send_msg, 0, sizeof(conn->send_msg));
+    conn->send_msg.msg_iov = conn->send_iov;
+    conn->send_msg.msg_iovlen = http_response_iov(entry->response, entry->offset, conn->send_iov, HTTP_RESPONSE_IOV);
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = conn->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&conn->send_msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+
+    conn->send_armed = true;
+    conn->uring_pending++;
+    connection_update_timer(conn);
+
+    if (link_close) {
+        sqe->flags |= IOSQE_IO_LINK;
+        return uring_queue_close(conn);
+    }
+
+    return 0;
+}
+
+// Riarma la recv quando serve: non su una connessione in chiusura, e non
+// mentre c'è una risposta in sospeso e già molto input in pipeline
+static int uring_update_recv(connection_t *conn) {
+    bool paused = conn->close_after_write ||
+                  ((conn->in_flight || conn->out_head) && conn->in_len >= CONNECTION_PIPELINE_LIMIT);
+
+    if (paused) {
+        if (conn->recv_canceling || !conn->recv_armed) {
+            return 0;
+        }
+        if (uring_cancel_recv(conn) < 0) {
+            return -1;
+        }
+        // La recv multishot continua a produrre CQE finché la cancellazione
+        // non arriva al kernel: va inviata subito, non al prossimo giro
+        if (uring_submit(conn->reactor->uring, false, -1) < 0 && errno != EINTR && errno != EBUSY) {
+            perror("io_uring_enter failed");
+        }
+        return 0;
+    }
+
+    if (!conn->recv_armed && !conn->closing) {
+        return uring_arm_recv(conn);
+    }
+
+    return 0;
+}
+
+// Libera la connessione quando nessuna operazione del ring la riferisce più
+// e nessun worker ne possiede la richiesta
+static void uring_release_if_idle(connection_t *conn) {
+    if (!conn->closing || conn->uring_pending > 0 || conn->in_flight) {
+        return;
+    }
+
+    if (!conn->fd_closed) {
+        close(conn->fd);
+    }
+    connection_release(conn);
+}
+
+// Avvia la chiusura: cancella la recv e chiude il socket tramite il ring.
+// La memoria viene liberata all'ultima completion; se il ring non accetta
+// altre SQE il fd viene chiuso in modo sincrono da uring_release_if_idle.
+static void uring_close_connection(connection_t *conn) {
+    if (!conn->closing) {
+        conn->closing = true;
+        connection_update_timer(conn);
+        uring_cancel_recv(conn);
+        uring_cancel_send(conn);
+        if (!conn->fd_closed && !conn->close_queued) {
+            uring_queue_close(conn);
+        }
+    }
+
+    uring_release_if_idle(conn);
+}
+
+// Porta avanti le richieste in pipeline e aggiorna la recv
+static void uring_process_input(connection_t *conn) {
+    if (conn->closing) {
+        uring_release_if_idle(conn);
+        return;
+    }
+
+    if (!conn->close_after_write && dispatch_connection_request(conn) < 0) {
+        uring_close_connection(conn);
+        return;
+    }
+
+    if (uring_update_recv(conn) < 0) {
+        uring_close_connection(conn);
+        return;
+    }
+
+    connection_update_timer(conn);
+}
+
+static int handle_uring_accept(reactor_t *reactor, struct io_uring_cqe *cqe) {
+    uring_t *ring = reactor->uring;
+
+    // Connessione in coda dopo un EMFILE: si torna all'accept multishot
+    if (ring->accept_polling) {
+        ring->accept_polling = false;
+        if (uring_arm_accept(reactor) < 0) {
+            printf("Errore nel riarmare l'accept multishot\n");
+        }
+        return 0;
+    }
+
+    bool exhausted = cqe->res == -EMFILE || cqe->res == -ENFILE;
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        int result = exhausted ? uring_arm_accept_poll(reactor) : uring_arm_accept(reactor);
+        if (result < 0) {
+            printf("Errore nel riarmare l'accept multishot\n");
+        }
+    }
+
+    if (cqe->res < 0) {
+        errno = -cqe->res;
+        perror("Accept failed");
+        if (exhausted) {
+            reactor_shed_connection(reactor);
+        }
+        return 0;
+    }
+
+    connection_t *conn = connection_open(cqe->res, reactor);
+    if (!conn) {
+        close(cqe->res);
+        return 0;
+    }
+
+    if (uring_arm_recv(conn) < 0) {
+        connection_close(conn);
+        return 0;
+    }
+    connection_update_timer(conn);
+
+    return 1;
+}
+
+static void handle_uring_recv(connection_t *conn, struct io_uring_cqe *cqe) {
+    uring_t *ring = conn->reactor->uring;
+
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        conn->recv_armed = false;
+        conn->recv_canceling = false;
+        conn->uring_pending--;
+    }
+
+    if (cqe->res > 0) {
+        unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        int error = 0;
+
+        if (!conn->closing) {
+            error = connection_reserve_input(conn, cqe->res);
+            if (error == 0) {
+                memcpy(conn->in_buf + conn->in_len, ring->buffers + (size_t)bid * URING_BUFFER_SIZE, cqe->res);
+                conn->in_len += cqe->res;
+            }
+        }
+        uring_recycle_buffer(ring, bid);
+
+        if (error < 0) {
+            uring_close_connection(conn);
+            return;
+        }
+
+        uring_process_input(conn);
+        return;
+    }
+
+    if (cqe->res == 0) {
+        // Client disconnesso
+        printf("Client disconnesso\n");
+        uring_close_connection(conn);
+        return;
+    }
+
+    // Buffer esauriti o recv cancellata: si riarma se la connessione legge ancora
+    if (cqe->res == -ENOBUFS || cqe->res == -ECANCELED) {
+        uring_process_input(conn);
+        return;
+    }
+
+    errno = -cqe->res;
+    perror("recv failed");
+    uring_close_connection(conn);
+}
+
+static void handle_uring_send(connection_t *conn, struct io_uring_cqe *cqe) {
+    conn->send_armed = false;
+    conn->uring_pending--;
+
+    if (cqe->res < 0) {
+        if (cqe->res != -ECANCELED) {
+            errno = -cqe->res;
+            perror("send failed");
+        }
+        uring_close_connection(conn);
+        return;
+    }
+
+    connection_output_sent(conn, (size_t)cqe->res);
+
+    if (conn->closing) {
+        uring_release_if_idle(conn);
+        return;
+    }
+
+    // Send parziale o altre risposte in coda
+    if (conn->out_head) {
+        if (cqe->res > 0) {
+            connection_restart_timer(conn);
+        }
+        if (uring_arm_send(conn) < 0) {
+            uring_close_connection(conn);
+        }
+        return;
+    }
+
+    if (conn->close_after_write) {
+        // Con la close collegata già in volo basta attenderne la completion
+        if (conn->close_queued) {
+            conn->closing = true;
+        } else {
+            uring_close_connection(conn);
+        }
+        return;
+    }
+
+    // Risposta inviata: processa eventuali richieste già arrivate in pipeline
+    uring_process_input(conn);
+}
+
+static void handle_uring_close(connection_t *conn, struct io_uring_cqe *cqe) {
+    conn->close_queued = false;
+    conn->uring_pending--;
+
+    if (cqe->res == -ECANCELED) {
+        // La send collegata è fallita o è stata parziale. Se è stata
+        // riproposta la chiusura passa alla sua completion, altrimenti si chiude qui
+        if (!conn->send_armed) {
+            conn->closing = true;
+            uring_queue_close(conn);
+        }
+        uring_release_if_idle(conn);
+        return;
+    }
+
+    conn->fd_closed = true;
+    conn->closing = true;
+    uring_release_if_idle(conn);
+}
+
+// Una recv multishot che trova sempre dati pronti continua a girare senza
+// tornare in attesa, e la cancellazione può non trovarla (-ENOENT/-EALREADY):
+// se l'operazione è ancora attiva si riprova
+static void handle_uring_cancel(connection_t *conn, struct io_uring_cqe *cqe, bool send) {
+    conn->uring_pending--;
+
+    bool missed = cqe->res == -ENOENT || cqe->res == -EALREADY;
+
+    if (missed && send && conn->send_armed && conn->closing) {
+        uring_cancel_send(conn);
+    } else if (missed && !send && conn->recv_armed && conn->recv_canceling) {
+        conn->recv_canceling = false;
+        if (conn->closing) {
+            uring_cancel_recv(conn);
+        } else {
+            uring_process_input(conn);
+        }
+    }
+
+    uring_release_if_idle(conn);
+}
+
+// Risposte restituite dai worker: accodate e inviate con una send sul ring
+static void handle_uring_completions(reactor_t *reactor, struct io_uring_cqe *cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE) && uring_arm_eventfd(reactor) < 0) {
+        printf("Errore nel riarmare il poll sull'eventfd\n");
+    }
+
+    connection_t *conn = reactor_take_completions(reactor);
+
+    while (conn) {
+        connection_t *next = conn->next_completed;
+        http_response_t *response = conn->completed_response;
+
+        conn->next_completed = NULL;
+        conn->completed_response = NULL;
+        conn->in_flight = false;
+
+        if (conn->closing || !response) {
+            free_http_response(response);
+            uring_close_connection(conn);
+        } else if (connection_queue_output(conn, response) < 0) {
+            free_http_response(response);
+            uring_close_connection(conn);
+        } else {
+            if (!conn->completed_keep_alive) {
+                conn->close_after_write = true;
+            }
+            if (uring_arm_send(conn) < 0) {
+                uring_close_connection(conn);
+            }
+        }
+
+        conn = next;
+    }
+}
+
+static void uring_free(uring_t *ring) {
+    if (ring->buf_ring) munmap(ring->buf_ring, ring->buf_ring_size);
+    free(ring->buffers);
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if (ring->ring_ptr) munmap(ring->ring_ptr, ring->ring_size);
+    if (ring->ring_fd >= 0) close(ring->ring_fd);
+    free(ring);
+}
+
+// Crea il ring del reactor e registra i buffer per le recv. Ritorna -1 se il
+// kernel non supporta le funzioni richieste, così il chiamante può usare epoll.
+int uring_reactor_init(reactor_t *reactor) {
+    uring_t *ring = calloc(1, sizeof(uring_t));
+    if (!ring) {
+        return -1;
+    }
+    ring->ring_fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+    params.cq_entries = URING_ENTRIES * URING_CQ_FACTOR;
+
+    ring->ring_fd = sys_io_uring_setup(URING_ENTRIES, &params);
+    if (ring->ring_fd < 0) {
+        perror("io_uring_setup failed");
+        uring_free(ring);
+        return -1;
+    }
+
+    // Un solo mmap per SQ e CQ, e nessuna CQE persa se la CQ si riempie
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+        printf("io_uring: kernel troppo vecchio\n");
+        uring_free(ring);
+        return -1;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->ring_size = sq_size > cq_size ? sq_size : cq_size;
+
+    ring->ring_ptr = mmap(NULL, ring->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->ring_ptr == MAP_FAILED) {
+        ring->ring_ptr = NULL;
+        perror("mmap io_uring failed");
+        uring_free(ring);
+        return -1;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        perror("mmap io_uring sqes failed");
+        uring_free(ring);
+        return -1;
+    }
+
+    char *base = ring->ring_ptr;
+    ring->sq_head = (unsigned *)(base + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(base + params.sq_off.tail);
+    ring->sq_mask = *(unsigned *)(base + params.sq_off.ring_mask);
+    ring->sq_entries = *(unsigned *)(base + params.sq_off.ring_entries);
+    ring->sq_array = (unsigned *)(base + params.sq_off.array);
+    ring->sq_local_tail = *ring->sq_tail;
+
+    ring->cq_head = (unsigned *)(base + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(base + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(base + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(base + params.cq_off.cqes);
+
+    // Buffer ring: il kernel sceglie un buffer libero a ogni recv, quindi la
+    // memoria di ricezione non dipende dal numero di connessioni in attesa
+    ring->buf_ring_size = URING_BUFFER_COUNT * sizeof(struct io_uring_buf);
+    ring->buf_ring = mmap(NULL, ring->buf_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->buf_ring == MAP_FAILED) {
+        ring->buf_ring = NULL;
+        uring_free(ring);
+        return -1;
+    }
+
+    ring->buffers = malloc((size_t)URING_BUFFER_COUNT * URING_BUFFER_SIZE);
+    if (!ring->buffers) {
+        uring_free(ring);
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+    reg.ring_entries = URING_BUFFER_COUNT;
+    reg.bgid = URING_BUFFER_GROUP;
+
+    if (sys_io_uring_register(ring->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        perror("io_uring_register buffer ring failed");
+        uring_free(ring);
+        return -1;
+    }
+
+    for (unsigned short bid = 0; bid < URING_BUFFER_COUNT; bid++) {
+        uring_recycle_buffer(ring, bid);
+    }
+
+    reactor->uring = ring;
+
+    if (uring_arm_accept(reactor) < 0 || uring_arm_eventfd(reactor) < 0) {
+        reactor->uring = NULL;
+        uring_free(ring);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Libera il ring di un reactor il cui loop non gira più
+void uring_reactor_destroy(reactor_t *reactor) {
+    uring_free(reactor->uring);
+    reactor->uring = NULL;
+}
+
+static void handle_uring_timeout(timer_entry_t *entry, void *arg) {
+    connection_t *conn = entry->data;
+    (void)arg;
+
+    printf("Timeout %s sul fd %d: connessione chiusa\n", connection_timer_name(conn->timer_kind), conn->fd);
+    conn->timer_kind = CONNECTION_TIMER_NONE;
+    uring_close_connection(conn);
+}
+
+// Main loop del backend io_uring: una io_uring_enter invia le SQE accumulate
+// e attende le completion (al più fino al prossimo tick dei timer), che
+// vengono poi smistate per tipo di operazione
+void uring_reactor_run(reactor_t *reactor) {
+    uring_t *ring = reactor->uring;
+
+    while (!__atomic_load_n(&reactor->stopping, __ATOMIC_ACQUIRE)) {
+        int timeout = timer_wheel_next_timeout(&reactor->timers);
+        if (uring_submit(ring, true, timeout) < 0 && errno != EINTR && errno != EBUSY && errno != ETIME) {
+            perror("io_uring_enter failed");
+            break;
+        }
+        http_date_refresh();
+
+        int accepted = 0;
+        unsigned head = *ring->cq_head;
+
+        while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe cqe = ring->cqes[head & ring->cq_mask];
+            head++;
+            __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+            connection_t *conn = (connection_t *)(uintptr_t)(cqe.user_data & ~URING_OP_MASK);
+
+            switch (cqe.user_data & URING_OP_MASK) {
+                case URING_OP_ACCEPT:
+                    accepted += handle_uring_accept(reactor, &cqe);
+                    break;
+                case URING_OP_EVENTFD:
+                    handle_uring_completions(reactor, &cqe);
+                    break;
+                case URING_OP_RECV:
+                    handle_uring_recv(conn, &cqe);
+                    break;
+                case URING_OP_SEND:
+                    handle_uring_send(conn, &cqe);
+                    break;
+                case URING_OP_CLOSE:
+                    handle_uring_close(conn, &cqe);
+                    break;
+                case URING_OP_CANCEL:
+                    handle_uring_cancel(conn, &cqe, false);
+                    break;
+                case URING_OP_CANCEL_SEND:
+                    handle_uring_cancel(conn, &cqe, true);
+                    break;
+            }
+        }
+
+        if (accepted > 0) {
+            printf("Client connessi con successo: %d\n", accepted);
+        }
+
+        timer_wheel_advance(&reactor->timers, handle_uring_timeout, reactor);
+    }
+}
@@ -1,7 +1,47 @@
 #include "workers.h"
 #include "requests_queue.h"
 #include "server_utils.h"
+#include "server_config.h"
 #include "book.h"
+#include "router.h"
+#include "http_compress.h"
+#include "book_cache.h"
+
+// Route del servizio: /books/{id} prende l'id dal path (un GET non ha body da
+// leggere); gli endpoint storici lo leggono dal body JSON o MessagePack
+static const route_t book_routes[] = {
+    { HTTP_POST,   "/books",       crud_create },
+    { HTTP_GET,    "/books/{id}",  crud_read },
+    { HTTP_PUT,    "/books/{id}",  crud_update },
+    { HTTP_DELETE, "/books/{id}",  crud_delete },
+
+    { HTTP_POST,   "/add/book",    crud_create },
+    { HTTP_GET,    "/get/book",    crud_read },
+    { HTTP_GET,    "/get/books",   crud_read },
+    { HTTP_PUT,    "/update/book", crud_update },
+    { HTTP_DELETE, "/delete/book", crud_delete },
+
+    { HTTP_GET,    "/stats",       server_stats },
+};
+
+// Costruito una volta prima di avviare i worker, poi solo letto
+static router_t book_router;
+
+// Risposte di errore costanti, preparate insieme al router
+static http_prebuilt_body_t not_found_body;
+static http_prebuilt_body_t method_not_allowed_body;
+static http_prebuilt_body_t redis_unavailable_body;
+
+static int init_prebuilt_bodies(void) {
+    static const char json[] = "application/json; charset=utf-8";
+
+    if (http_prebuilt_body_init(&not_found_body, "{\"error\": \"Endpoint non trovato\"}", json) < 0 ||
+        http_prebuilt_body_init(&method_not_allowed_body, "{\"error\": \"Metodo non supportato\"}", json) < 0 ||
+        http_prebuilt_body_init(&redis_unavailable_body, "{\"error\": \"Database non disponibile, riprova più tardi\"}", json) < 0) {
+        return -1;
+    }
+    return 0;
+}
 
 
 // Inizializza il pool di worker thread
@@ -17,13 +57,22 @@ worker_pool_t* worker_pool_init(int num_threads, void* (*process_func)(void*)) {
         return NULL;
     }
 
-    pool->queue = createQueue(20);
+    pool->queue = createQueue(server_config.queue_size);
     if (!pool->queue) {
         free(pool->threads);
         free(pool);
         return NULL;
     }
 
+    if (init_prebuilt_bodies() < 0 || router_init(&book_router) < 0 ||
+        router_add_routes(&book_router, book_routes, sizeof(book_routes) / sizeof(book_routes[0])) < 0) {
+        printf("Errore nella costruzione della tabella delle route\n");
+        router_destroy(&book_router);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+
     pool->num_threads = num_threads;
     pool->shutdown = false;
     pool->process_function = process_func;
@@ -42,52 +91,126 @@ worker_pool_t* worker_pool_init(int num_threads, void* (*process_func)(void*)) {
     return pool;
 }
 
+// 503 quando Redis non è raggiungibile: la connessione si riprova con backoff
+static void set_response_redis_unavailable(http_response_t *response) {
+    char retry_after[16];
+    snprintf(retry_after, sizeof(retry_after), "%d", server_config.retry_after);
+
+    set_response_status(response, HTTP_SERVICE_UNAVAILABLE);
+    add_response_header(response, "Retry-After", retry_after);
+    set_response_prebuilt_body(response, &redis_unavailable_body);
+}
+
+// Ultima fase di una richiesta: compressione, keep-alive e consegna della
+// risposta al reactor, che la invia senza bloccare il worker
+static void finish_request(client_request_node_t *node, http_response_t *response,
+                           http_compressor_t *compressor) {
+    connection_t *conn = node->connection;
+    conn->requests_served++;
+
+    // La connessione resta aperta se il client lo chiede (o usa HTTP/1.1)
+    // e non ha ancora esaurito le richieste consentite
+    bool keep_alive = http_request_keep_alive(&node->request)
+        && conn->requests_served < server_config.keepalive_max_requests;
+
+    if (response) {
+        if (http_compress_response(compressor, &node->request, response) != 0) {
+            printf("Errore nella compressione della risposta\n");
+        }
+        set_response_keep_alive(response, keep_alive);
+
+        if (build_response(response) != 0) {
+            free_http_response(response);
+            response = NULL;
+        }
+    }
+
+    // Con il nodo se ne va il buffer che conteneva la richiesta
+    free_request_node(node);
+
+    // L'invio sul socket (e la chiusura se non keep-alive) spetta al
+    // reactor: il worker non si blocca mai su un client lento
+    reactor_post_completion(conn, response, keep_alive);
+}
+
 void* worker_thread(void *arg) {
     // Copia il thread_id subito
     int thread_id = *(int*)arg;
     
     sleep(3);
     
-    redisContext *c = get_redis_connection();
-    if (c == NULL) {
-        return NULL;  // Fix: return NULL invece di return void
-    }
+    // Con --redis-pin la connessione è del worker per tutta la sua vita,
+    // altrimenti viene presa dal pool solo per la durata di un batch
+    redis_slot_t *pinned = server_config.redis_pin ? redis_pool_checkout(redis_pool) : NULL;
+
+    // Stream zlib del worker, riusati per tutte le sue risposte
+    http_compressor_t compressor;
+    http_compressor_init(&compressor, server_config.gzip_level, server_config.gzip_min_size);
+
+    client_request_node_t *batch[MAX_BATCH_SIZE];
+    http_response_t *responses[MAX_BATCH_SIZE];
+    book_call_t calls[MAX_BATCH_SIZE];
 
-    client_request_node_t *incoming_request = malloc(sizeof(client_request_node_t));
-    if (!incoming_request) {
-        redisFree(c);
-        return NULL;
-    }
-    
     while (1) {
         // Assumendo che worker_pool sia una variabile globale visibile
-        if (dequeue_node(worker_pool->queue, incoming_request)) {
-            http_response_t *response = process_rest_request(&incoming_request->request, c);
-            
-            if (response) {
-                const char *response_string = get_response_string(response);
-                if (response_string) {
-                    printf("\n--- Risposta raw ---\n");
-                    printf("%s\n", response_string);
-                    send(incoming_request->client_fd, response_string, strlen(response_string), 0);
+        int count = dequeue_batch(worker_pool->queue, batch, server_config.batch_size,
+                                  server_config.batch_linger_us);
+        if (count > 0) {
+            // Si sono liberati degli slot: riprendi le connessioni in attesa di capacità
+            reactor_notify_capacity();
+
+            redis_slot_t *slot = pinned ? pinned : redis_pool_checkout(redis_pool);
+            redisContext *c = slot ? redis_slot_context(redis_pool, slot) : NULL;
+
+            // Group commit: ogni richiesta del batch accoda il suo comando nel
+            // buffer della connessione senza attendere risposta...
+            for (int i = 0; i < count; i++) {
+                calls[i].redis = c;
+                calls[i].async = NULL;
+                calls[i].complete = NULL;
+                responses[i] = process_rest_request(&batch[i]->request, &calls[i]);
+            }
+
+            // ...poi la prima redisGetReply scrive tutti i comandi con una
+            // sola write e le risposte, nello stesso ordine, tornano alle
+            // richieste che le aspettano: un round trip per l'intero batch.
+            // Se la connessione cade, le richieste restanti ricevono NULL
+            for (int i = 0; i < count; i++) {
+                if (!calls[i].complete) {
+                    continue;
                 }
-                free_http_response(response);
+
+                void *reply = NULL;
+                if (redisGetReply(c, &reply) != REDIS_OK) {
+                    reply = NULL;
+                }
+                if (responses[i]) {
+                    calls[i].complete(&calls[i], reply, responses[i]);
+                }
+                if (reply) {
+                    freeReplyObject(reply);
+                }
+            }
+
+            if (slot && slot != pinned) {
+                redis_pool_checkin(redis_pool, slot);
+            }
+
+            for (int i = 0; i < count; i++) {
+                finish_request(batch[i], responses[i], &compressor);
             }
-            
-            // Chiudi il socket del client
-            close(incoming_request->client_fd);
         }
         
         // Controllo per shutdown
         if (worker_pool->shutdown) {
             break;
         }
-        
-        printQueue(worker_pool->queue);
     }
     
-    free(incoming_request);
-    redisFree(c);
+    http_compressor_destroy(&compressor);
+    if (pinned) {
+        redis_pool_checkin(redis_pool, pinned);
+    }
     return NULL;
 }
 
@@ -119,203 +242,434 @@ void worker_pool_destroy(worker_pool_t *pool) {
     free(pool);
 }
 
-void crud_create(const http_request_t *request, http_response_t *response, redisContext *c){
+// Media type (senza parametri) di un body MessagePack
+static bool is_msgpack_media_type(const char *value) {
+    size_t length = strcspn(value, "; \t");
+    return (length == 19 && strncasecmp(value, "application/msgpack", 19) == 0) ||
+           (length == 21 && strncasecmp(value, "application/x-msgpack", 21) == 0);
+}
 
-    if(strncmp(request->path, "/add/book", 10) != 0) {
-        printf("Endpoint non supportato: %s\n", request->path);
-        set_response_status(response, HTTP_NOT_FOUND);
-        set_response_json(response, "{\"error\": \"Endpoint non trovato\"}");
-        return;
+// Formato del body ricevuto, da Content-Type; JSON se manca
+static book_format_t request_body_format(const http_request_t *request) {
+    const char *content_type = http_request_header(request, HTTP_HEADER_CONTENT_TYPE);
+    return content_type && is_msgpack_media_type(content_type) ? BOOK_FORMAT_MSGPACK : BOOK_FORMAT_JSON;
+}
+
+// Formato della risposta secondo Accept: MessagePack solo se elencato
+// esplicitamente con peso non inferiore a JSON. A parità di peso un tipo
+// esplicito vince su "application/*" e "*/*", che da soli restano JSON
+static book_format_t response_book_format(const http_request_t *request) {
+    const char *accept = http_request_header(request, HTTP_HEADER_ACCEPT);
+    if (!accept) {
+        return BOOK_FORMAT_JSON;
     }
 
-    Book new_book;
+    int msgpack = http_header_quality(accept, "application/msgpack");
+    int x_msgpack = http_header_quality(accept, "application/x-msgpack");
+    if (x_msgpack > msgpack) {
+        msgpack = x_msgpack;
+    }
+    if (msgpack <= 0) {
+        return BOOK_FORMAT_JSON;
+    }
 
-    if (parse_book_json(request->body, &new_book)) {
-        printf("Parsing completato con successo!\n\n");
-    } else {
-        printf("Errore durante il parsing del JSON\n");
+    int json = http_header_quality(accept, "application/json");
+    if (json >= 0) {
+        return msgpack > json ? BOOK_FORMAT_MSGPACK : BOOK_FORMAT_JSON;
+    }
+
+    int wildcard = http_header_quality(accept, "application/*");
+    int any = http_header_quality(accept, "*/*");
+    return msgpack >= (wildcard > any ? wildcard : any) ? BOOK_FORMAT_MSGPACK : BOOK_FORMAT_JSON;
+}
 
+// Libro indicato dalla richiesta: i campi vengono dal body (JSON o
+// MessagePack secondo Content-Type), se c'è; l'id del path (/books/{id})
+// ha la precedenza su quello del body. HTTP_NOT_FOUND se l'id del path non
+// è un intero non negativo; HTTP_BAD_REQUEST, con l'errore descritto in
+// error, se il body non è valido o mancano sia il body sia l'id
+static http_status_t request_book(const http_request_t *request, const route_params_t *params, Book *book,
+                                  book_parse_error_t *error) {
+    int path_id;
+    int path_result = route_param_int(params, "id", &path_id);
+    bool found = false;
+
+    if (path_result == ROUTE_PARAM_INVALID) {
+        return HTTP_NOT_FOUND;
     }
 
-    
-    if (save_book(c, &new_book) == -1) {
-        set_response_status(response, HTTP_INTERNAL_SERVER_ERROR);
-        set_response_json(response, "{\"error\": \"Errore interno al server...riprova e sarai più fortunato...\"}");
-        add_response_header(response, "X-Custom-Header", "MyValue");
-        return;  // Importante: return dopo l'errore
+    memset(book, 0, sizeof(Book));
+    if (request->body) {
+        bool parsed = request_body_format(request) == BOOK_FORMAT_MSGPACK
+            ? parse_book_msgpack(request->body, request->body_length, book, error)
+            : parse_book_json(request->body, request->body_length, book, error);
+        if (!parsed) {
+            return HTTP_BAD_REQUEST;
+        }
+        found = true;
+    }
+
+    if (path_result == 0) {
+        book->id = path_id;
+        found = true;
     }
-    
-    set_response_status(response, HTTP_CREATED);
-    set_response_json(response, request->body);
-    add_response_header(response, "X-Custom-Header", "MyValue");
 
+    if (!found) {
+        error->position = 0;
+        error->message = "Libro mancante";
+        return HTTP_BAD_REQUEST;
+    }
+    return HTTP_OK;
 }
 
-void crud_read(const http_request_t *request, http_response_t *response, redisContext *c) {
-    if (strncmp(request->path, "/get/books", 11) != 0) {
-        printf("Endpoint non supportato: %s\n", request->path);
-        set_response_status(response, HTTP_NOT_FOUND);
-        set_response_json(response, "{\"error\": \"Endpoint non trovato\"}");
+// 400 con l'errore del reader, in JSON qualunque sia il formato del body
+static void set_response_invalid_book(const http_request_t *request, http_response_t *response,
+                                      const book_parse_error_t *error) {
+    json_writer_t writer;
+
+    json_writer_init(&writer, response);
+    json_begin_object(&writer);
+    json_key(&writer, "error");
+    json_cstring(&writer, request_body_format(request) == BOOK_FORMAT_MSGPACK ?
+                 "MessagePack non valido" : "JSON non valido");
+    json_key(&writer, "message");
+    json_cstring(&writer, error->message);
+    json_key(&writer, "position");
+    json_int(&writer, (long long)error->position);
+    json_end_object(&writer);
+
+    if (json_writer_finish(&writer) != 0) {
+        set_response_status(response, HTTP_INTERNAL_SERVER_ERROR);
+        set_response_json(response, "{\"error\": \"Response troppo grande\"}");
         return;
     }
+    set_response_status(response, HTTP_BAD_REQUEST);
+}
 
-    Book new_book;
-    if (parse_book_json(request->body, &new_book)) {
-        printf("Parsing completato con successo!\n\n");
+// Libro della richiesta in call->book; se non è valido la risposta è già
+// l'errore (400 o 404) e nessun comando deve partire verso Redis
+static bool read_request_book(book_call_t *call, const http_request_t *request,
+                              const route_params_t *params, http_response_t *response) {
+    book_parse_error_t error;
+
+    switch (request_book(request, params, &call->book, &error)) {
+        case HTTP_OK:
+            return true;
+        case HTTP_NOT_FOUND:
+            set_response_status(response, HTTP_NOT_FOUND);
+            set_response_json(response, "{\"error\": \"Libro non trovato\"}");
+            return false;
+        default:
+            set_response_invalid_book(request, response, &error);
+            return false;
+    }
+}
+
+// Libro serializzato direttamente nel body della risposta, nel formato
+// negoziato con Accept
+static void set_response_book(const http_request_t *request, http_response_t *response,
+                              http_status_t status, const Book *book) {
+    int result;
+
+    if (response_book_format(request) == BOOK_FORMAT_MSGPACK) {
+        msgpack_writer_t writer;
+        msgpack_writer_init(&writer, response);
+        write_book_msgpack(&writer, book);
+        result = msgpack_writer_finish(&writer);
     } else {
-        printf("Errore durante il parsing del JSON\n");
-        set_response_status(response, HTTP_BAD_REQUEST);
-        set_response_json(response, "{\"error\": \"JSON non valido\"}");
+        json_writer_t writer;
+        json_writer_init(&writer, response);
+        write_book_json(&writer, book);
+        result = json_writer_finish(&writer);
+    }
+
+    if (result != 0) {
+        set_response_status(response, HTTP_INTERNAL_SERVER_ERROR);
+        set_response_json(response, "{\"error\": \"Response troppo grande\"}");
         return;
     }
 
-    Book *loaded_book = load_book(c, new_book.id);
-    if (loaded_book == NULL) {
-        set_response_status(response, HTTP_NOT_FOUND);
-        set_response_json(response, "{\"error\": \"Libro non trovato\"}");
+    set_response_status(response, status);
+    add_response_vary(response, "Accept");
+}
+
+static void set_response_redis_error(http_response_t *response) {
+    set_response_status(response, HTTP_INTERNAL_SERVER_ERROR);
+    set_response_json(response, "{\"error\": \"Errore interno al server...riprova e sarai più fortunato...\"}");
+    add_response_header(response, "X-Custom-Header", "MyValue");
+}
+
+static void async_reply(redisAsyncContext *context, void *reply, void *privdata);
+
+// Invia il comando della richiesta e registra la continuazione che riceverà
+// la risposta. Nei worker il comando resta nel buffer della connessione e
+// parte con il resto del batch; con --redis-async va al client del reactor,
+// che chiama la continuazione quando la risposta arriva dal socket
+static void send_command(book_call_t *call, http_response_t *response, book_complete_fn complete,
+                         char *command, int length) {
+    int result = REDIS_ERR;
+
+    // Redis non raggiungibile: le richieste servite dalla cache vanno avanti
+    if (!call->redis && !call->async) {
+        if (length >= 0) {
+            redisFreeCommand(command);
+        }
+        call->complete = NULL;
+        set_response_redis_unavailable(response);
         return;
     }
-    
-    char resp_body[512];  // Buffer più grande per sicurezza
-    int ret = snprintf(resp_body, sizeof(resp_body),
-        "{\n"
-        "    \"id_book\": %d,\n"
-        "    \"title\": \"%s\",\n"
-        "    \"author\": \"%s\",\n"
-        "    \"price\": %.2f\n"
-        "}",
-        loaded_book->id, loaded_book->title, loaded_book->author, loaded_book->price);
-    
-    if (ret >= sizeof(resp_body)) {
-        set_response_status(response, HTTP_INTERNAL_SERVER_ERROR);
-        set_response_json(response, "{\"error\": \"Response troppo grande\"}");
-        free(loaded_book);  // Assumendo che esista questa funzione
+
+    if (length >= 0) {
+        result = call->async
+            ? redisAsyncFormattedCommand(call->async, async_reply, call, command, length)
+            : redisAppendFormattedCommand(call->redis, command, length);
+        redisFreeCommand(command);
+    }
+
+    if (result != REDIS_OK) {
+        // Nessuna risposta da attendere
+        call->complete = NULL;
+        set_response_redis_error(response);
         return;
     }
+    call->complete = complete;
+}
 
-    set_response_status(response, HTTP_OK);
-    set_response_json(response, resp_body);
+static void crud_create_done(book_call_t *call, const redisReply *reply, http_response_t *response) {
+    if (save_book_reply(&call->book, reply) < 0) {
+        set_response_redis_error(response);
+        return;
+    }
+
+    set_response_book(call->request, response, HTTP_CREATED, &call->book);
     add_response_header(response, "X-Custom-Header", "MyValue");
-    
-    free(loaded_book);  // Libera la memoria
 }
 
-void crud_delete(const http_request_t *request, http_response_t *response, redisContext *c ){
-    if(strncmp(request->path, "/delete/book", 13) != 0) {
-        printf("Endpoint non supportato: %s\n", request->path);
+void crud_create(const http_request_t *request, const route_params_t *params, http_response_t *response, void *context) {
+    book_call_t *call = context;
+
+    if (!read_request_book(call, request, params, response)) {
+        return;
+    }
+
+    char *command;
+    int length = format_save_book(&command, &call->book);
+    send_command(call, response, crud_create_done, command, length);
+}
+
+static void crud_read_done(book_call_t *call, const redisReply *reply, http_response_t *response) {
+    int found = load_book_reply(reply, &call->book);
+    if (found < 0) {
+        set_response_redis_error(response);
+        return;
+    }
+    if (found == 0) {
         set_response_status(response, HTTP_NOT_FOUND);
-        set_response_json(response, "{\"error\": \"Endpoint non trovato\"}");
+        set_response_json(response, "{\"error\": \"Libro non trovato\"}");
         return;
     }
 
-    Book new_book;
+    book_cache_fill(&book_cache, &call->book, call->cache_version);
+    set_response_book(call->request, response, HTTP_OK, &call->book);
+    add_response_header(response, "X-Custom-Header", "MyValue");
+}
 
-    if (parse_book_json(request->body, &new_book)) {
-        printf("Parsing completato con successo!\n\n");
-    } else {
-        printf("Errore durante il parsing del JSON\n");
+void crud_read(const http_request_t *request, const route_params_t *params, http_response_t *response, void *context) {
+    book_call_t *call = context;
 
+    if (!read_request_book(call, request, params, response)) {
+        return;
     }
 
-    
-    
-    if(delete_book(c,new_book.id) < 0){
-        set_response_status(response, HTTP_INTERNAL_SERVER_ERROR);
-        set_response_json(response, "{\"error\": \ Errore interno al server...riprova e sarai più fortunato... \"}");
+    // Un hit risponde subito, senza comandi né attesa della connessione
+    int book_id = call->book.id;
+    if (book_cache_get(&book_cache, book_id, &call->book, &call->cache_version)) {
+        set_response_book(request, response, HTTP_OK, &call->book);
         add_response_header(response, "X-Custom-Header", "MyValue");
+        return;
     }
-    
-    char resp_body[256];
-    snprintf(resp_body, 256,
-        "{\n"
-        "    \"id_book\": %d,\n"
-        "    \"title\": \"%s\",\n"
-        "    \"author\": \"%s\",\n"
-        "    \"price\": %.2f\n"
-        "}",
-        new_book.id, new_book.title, new_book.author, new_book.price);
 
-    
-    set_response_status(response,  HTTP_NO_CONTENT);
-    set_response_json(response, resp_body);
-    add_response_header(response, "X-Custom-Header", "MyValue");
+    char *command;
+    int length = format_load_book(&command, book_id);
+    send_command(call, response, crud_read_done, command, length);
+}
+
+static void crud_delete_done(book_call_t *call, const redisReply *reply, http_response_t *response) {
+    if (delete_book_reply(call->book.id, reply) < 0) {
+        set_response_redis_error(response);
+        return;
+    }
 
+    // 204: nessun body
+    set_response_status(response, HTTP_NO_CONTENT);
+    add_response_header(response, "X-Custom-Header", "MyValue");
 }
 
-void crud_update(const http_request_t *request, http_response_t *response, redisContext *c ){
+void crud_delete(const http_request_t *request, const route_params_t *params, http_response_t *response, void *context) {
+    book_call_t *call = context;
 
-     if(strncmp(request->path, "/update/book", 13) != 0) {
-        printf("Endpoint non supportato: %s\n", request->path);
-        set_response_status(response, HTTP_NOT_FOUND);
-        set_response_json(response, "{\"error\": \"Endpoint non trovato\"}");
+    if (!read_request_book(call, request, params, response)) {
         return;
     }
 
-    Book new_book;
+    char *command;
+    int length = format_delete_book(&command, call->book.id);
+    send_command(call, response, crud_delete_done, command, length);
+}
 
-    if (parse_book_json(request->body, &new_book)) {
-        printf("Parsing completato con successo!\n\n");
-    } else {
-        printf("Errore durante il parsing del JSON\n");
+static void crud_update_done(book_call_t *call, const redisReply *reply, http_response_t *response) {
+    if (update_book_price_reply(call->book.id, call->book.price, reply) < 0) {
+        set_response_redis_error(response);
+        return;
+    }
 
+    set_response_book(call->request, response, HTTP_OK, &call->book);
+    add_response_header(response, "X-Custom-Header", "MyValue");
+}
+
+void crud_update(const http_request_t *request, const route_params_t *params, http_response_t *response, void *context) {
+    book_call_t *call = context;
+
+    if (!read_request_book(call, request, params, response)) {
+        return;
     }
 
-    
-    
-    if(update_book_price(c,new_book.id, new_book.price) < 0){
+    char *command;
+    int length = format_update_book_price(&command, call->book.id, call->book.price);
+    send_command(call, response, crud_update_done, command, length);
+}
+
+// Contatori del server in JSON; non tocca Redis
+void server_stats(const http_request_t *request, const route_params_t *params, http_response_t *response, void *context) {
+    book_cache_stats_t cache;
+    json_writer_t writer;
+    (void)request;
+    (void)params;
+    (void)context;
+
+    book_cache_stats(&book_cache, &cache);
+
+    json_writer_init(&writer, response);
+    json_begin_object(&writer);
+    json_key(&writer, "book_cache");
+    json_begin_object(&writer);
+    json_key(&writer, "enabled");
+    json_bool(&writer, book_cache.enabled);
+    json_key(&writer, "hits");
+    json_int(&writer, (long long)cache.hits);
+    json_key(&writer, "misses");
+    json_int(&writer, (long long)cache.misses);
+    json_key(&writer, "evictions");
+    json_int(&writer, (long long)cache.evictions);
+    json_key(&writer, "expirations");
+    json_int(&writer, (long long)cache.expirations);
+    json_key(&writer, "entries");
+    json_int(&writer, cache.entries);
+    json_key(&writer, "capacity");
+    json_int(&writer, cache.capacity);
+    json_end_object(&writer);
+    json_end_object(&writer);
+
+    if (json_writer_finish(&writer) != 0) {
         set_response_status(response, HTTP_INTERNAL_SERVER_ERROR);
-        set_response_json(response, "{\"error\": \ Errore interno al server...riprova e sarai più fortunato... \"}");
-        add_response_header(response, "X-Custom-Header", "MyValue");
+        set_response_json(response, "{\"error\": \"Response troppo grande\"}");
+        return;
     }
-    
-    char resp_body[256];
-    snprintf(resp_body, 256,
-        "{\n"
-        "    \"id_book\": %d,\n"
-        "    \"title\": \"%s\",\n"
-        "    \"author\": \"%s\",\n"
-        "    \"price\": %.2f\n"
-        "}",
-        new_book.id, new_book.title, new_book.author, new_book.price);
-
-    
     set_response_status(response, HTTP_OK);
-    set_response_json(response, resp_body);
-    add_response_header(response, "X-Custom-Header", "MyValue");
-
 }
 
-http_response_t* process_rest_request(http_request_t *request, redisContext *c){
+// Prima fase della richiesta: routing e, se serve Redis, comando accodato
+// in call. La risposta è completa solo se call->complete resta NULL
+http_response_t* process_rest_request(http_request_t *request, book_call_t *call){
+
+    call->request = request;
+    call->complete = NULL;
 
     http_response_t *response = create_http_response();
+    if (!response) {
+        return NULL;
+    }
 
-    // Routing basato sul metodo HTTP
-    switch (request->method) {
-        case HTTP_POST:
-            crud_create(request, response,c);
-            break;
-            
-        case HTTP_GET:
-            crud_read(request, response,c);
-            break;
-            
-        case HTTP_PUT:
-            crud_update(request, response,c);
-        case HTTP_PATCH:
-            
+    const char *path = http_request_str(request, request->path);
+    route_match_t match;
+
+    // Routing su metodo e path
+    switch (router_match(&book_router, request->method, path, request->path.length, &match)) {
+        case ROUTER_MATCH:
+            match.handler(request, &match.params, response, call);
             break;
-            
-        case HTTP_DELETE:
-            crud_delete(request,response,c);
+
+        case ROUTER_METHOD_NOT_ALLOWED: {
+            char allow[128];
+            printf("Metodo HTTP non supportato: %s %s\n", http_request_str(request, request->method_str), path);
+            set_response_status(response, HTTP_METHOD_NOT_ALLOWED);
+            set_response_prebuilt_body(response, &method_not_allowed_body);
+            if (router_allow_header(match.allowed_methods, allow, sizeof(allow)) == 0) {
+                add_response_header(response, "Allow", allow);
+            }
             break;
-            
+        }
+
         default:
-            printf("Metodo HTTP non supportato: %s\n", request->method_str);
-            set_response_status(response, HTTP_METHOD_NOT_ALLOWED);
-            set_response_json(response, "{\"error\": \"Metodo non supportato\"}");
-            add_response_header(response, "Allow", "GET, POST, PUT, PATCH, DELETE");
+            printf("Endpoint non supportato: %s\n", path);
+            set_response_status(response, HTTP_NOT_FOUND);
+            set_response_prebuilt_body(response, &not_found_body);
             break;
     }
 
     return response;
-}
\ No newline at end of file
+}
+
+// Richiesta servita dal reactor con --redis-async: resta in vita, senza
+// thread dedicato, finché non arriva la risposta al suo comando
+typedef struct {
+    book_call_t call;               // Primo campo: è il privdata del comando
+    client_request_node_t *node;
+    http_response_t *response;
+    http_compressor_t *compressor;
+} async_request_t;
+
+// Continuazione chiamata da hiredis sul thread del reactor. reply è NULL se
+// la connessione è caduta o non si è mai stabilita: nel secondo caso la
+// richiesta riceve la stessa 503 dei worker
+static void async_reply(redisAsyncContext *context, void *reply, void *privdata) {
+    async_request_t *pending = privdata;
+    redis_async_t *redis = context->data;
+
+    if (!pending->response) {
+        // Nessuna risposta da completare: la connessione verrà chiusa
+    } else if (!reply && !redis->connected) {
+        set_response_redis_unavailable(pending->response);
+    } else {
+        pending->call.complete(&pending->call, reply, pending->response);
+    }
+
+    finish_request(pending->node, pending->response, pending->compressor);
+    free(pending);
+}
+
+// Con --redis-async la richiesta non passa dalla coda dei worker: il
+// reactor esegue l'handler, che invia il comando e ritorna subito, e
+// continua a servire gli altri client. Ritorna -1 se non riesce ad
+// allocare lo stato della richiesta
+int async_process_request(reactor_t *reactor, client_request_node_t *node) {
+    async_request_t *pending = malloc(sizeof(async_request_t));
+    if (!pending) {
+        return -1;
+    }
+
+    pending->node = node;
+    pending->compressor = &reactor->compressor;
+    pending->call.redis = NULL;
+    pending->call.async = redis_async_context(&reactor->redis);
+    pending->call.complete = NULL;
+
+    pending->response = process_rest_request(&node->request, &pending->call);
+
+    // Nessun comando inviato: la risposta è già pronta
+    if (!pending->call.complete) {
+        finish_request(node, pending->response, pending->compressor);
+        free(pending);
+    }
+    return 0;
+}